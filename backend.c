@@ -0,0 +1,443 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "cnf_sink.h"
+#include "dlx.h"
+#include "handoff.h"
+
+/* Dancing links answer half-filled grids of up to 16 values within a few
+ * milliseconds, faster than any encoding, but blow up from 25 values on,
+ * where PicoSAT stays under a second up to 36 values and is ahead of
+ * Glucose on every size. */
+#define DLX_MAX_VALUES 16
+
+
+/***** Private functions *****/
+
+/* Encodes `sudoku` as selected by `opts`; `map` describes the resulting
+ * cell variables (dense and pruned, or the full n^3 layout). */
+static int _encode(CnfSink* sink, const Sudoku* sudoku,
+                   const BackendOptions* opts, VarMap* map)
+{
+    sink->amo_encoding = opts->amo_encoding;
+    if (opts->prune) {
+        return sudoku_encode_pruned(sink, sudoku, map);
+    }
+
+    map->n_vars = sudoku_encode_num_vars(sudoku);
+    map->first = NULL;
+    map->value_of = NULL;
+    return sudoku_encode(sink, sudoku);
+}
+
+
+static void _decode(Sudoku* sudoku, const VarMap* map, const int* model)
+{
+    if (map->first != NULL) {
+        sudoku_decode_pruned(sudoku, map, model);
+    } else {
+        sudoku_decode_model(sudoku, model);
+    }
+}
+
+
+static void _log_formula_size(const BackendOptions* opts,
+                              const CnfSink* sink)
+{
+    if (opts->log != NULL) {
+        fprintf(opts->log, "Formula has %d variables and %" PRId64
+                " clauses\n", sink->n_vars, sink->n_clauses);
+    }
+}
+
+
+/* Room for the values of the variables of `map`, allocated once the
+ * formula is known so it follows the live encoding. */
+static int* _alloc_model(const VarMap* map)
+{
+    return (int*)malloc((map->n_vars + 1) * sizeof(int));
+}
+
+
+/* Hands `model` to the caller if it wants it, releases it otherwise. */
+static void _give_model(BackendModel* model, VarMap* map, int* values)
+{
+    if (model != NULL) {
+        model->map = *map;
+        model->values = values;
+    } else {
+        var_map_release(map);
+        free(values);
+    }
+}
+
+
+/* Encoder thread of the streaming handoff. */
+typedef struct
+{
+    pthread_t thread;
+    const Sudoku* sudoku;
+    const BackendOptions* opts;
+    Handoff* handoff;
+    CnfSink sink;
+    int ret;        /* of the encoder */
+    int write_ret;  /* of the writer */
+} StreamWriter;
+
+
+static void* _stream_main(void* arg)
+{
+    StreamWriter* writer = (StreamWriter*)arg;
+
+    VarMap map = { 0, NULL, NULL };  /* same as the counting pass */
+    writer->ret = _encode(&writer->sink, writer->sudoku, writer->opts, &map);
+    writer->write_ret = cnf_sink_close_writer(&writer->sink);
+    var_map_release(&map);
+    handoff_end_write(writer->handoff);
+    return NULL;
+}
+
+
+/* Writes the whole instance before any solver starts. Returns
+ * RUN_SOLVER_UNKNOWN when the solver can be run, an error otherwise. */
+static RunSolverCode _write_instance(Handoff* handoff, const Sudoku* sudoku,
+                                     const BackendOptions* opts, VarMap* map,
+                                     CnfSink* sink)
+{
+    if (cnf_sink_open_writer(sink, handoff->fd) != 0) {
+        return RUN_SOLVER_ERR_STREAM;
+    }
+    int ret = _encode(sink, sudoku, opts, map);
+    int write_ret = cnf_sink_close_writer(sink);  /* patches the header */
+    if (ret != 0) {
+        return RUN_SOLVER_ERR_MEMORY;
+    } else if (write_ret != 0) {
+        return RUN_SOLVER_ERR_STREAM;
+    }
+    return RUN_SOLVER_UNKNOWN;
+}
+
+
+/* Sizes the instance with a counting pass, then starts a thread that
+ * encodes it again into the pipe while the solver parses it. Returns
+ * RUN_SOLVER_UNKNOWN when the solver can be run, an error otherwise. */
+static RunSolverCode _start_stream(StreamWriter* writer, Handoff* handoff,
+                                   const Sudoku* sudoku,
+                                   const BackendOptions* opts, VarMap* map,
+                                   CnfSink* sink)
+{
+    cnf_sink_init_counter(sink);
+    if (_encode(sink, sudoku, opts, map) != 0) {
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+
+    writer->sudoku = sudoku;
+    writer->opts = opts;
+    writer->handoff = handoff;
+    if (cnf_sink_open_stream(&writer->sink, handoff->fd, sink->n_vars,
+                             sink->n_clauses) != 0)
+    {
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+    if (pthread_create(&writer->thread, NULL, _stream_main, writer) != 0) {
+        cnf_sink_close_writer(&writer->sink);
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+    return RUN_SOLVER_UNKNOWN;
+}
+
+
+static RunSolverCode _solve_external(const Backend* backend, Sudoku* sudoku,
+                                     const BackendOptions* opts,
+                                     const Deadline* deadline,
+                                     Uniqueness* uniqueness,
+                                     BackendModel* model)
+{
+    (void)backend;
+    if (uniqueness != NULL) {  /* one answer per run, never a second */
+        *uniqueness = UNIQUENESS_UNKNOWN;
+    }
+
+    /* where to save the instance */
+    Handoff handoff;
+    if ((opts->stream ? handoff_open_pipe(&handoff)
+                      : handoff_open(&handoff, opts->instance_file)) != 0)
+    {
+        return RUN_SOLVER_ERR_STREAM;
+    }
+
+    CnfSink sink;
+    StreamWriter writer;
+    VarMap map = { 0, NULL, NULL };
+    RunSolverCode code = opts->stream
+        ? _start_stream(&writer, &handoff, sudoku, opts, &map, &sink)
+        : _write_instance(&handoff, sudoku, opts, &map, &sink);
+    if (code != RUN_SOLVER_UNKNOWN) {
+        handoff_close(&handoff);
+        var_map_release(&map);
+        return code;
+    }
+    _log_formula_size(opts, &sink);
+
+    /* auxiliary variables are reported too, but only the map is needed */
+    int* values = _alloc_model(&map);
+    SolverModel solver_model = { values, map.n_vars, 0, 0 };
+    int winner = -1;
+    code = RUN_SOLVER_ERR_MEMORY;
+    if (values != NULL) {
+        code = run_solver_race(opts->commands, opts->n_commands,
+                               handoff.path, &solver_model, deadline,
+                               &winner);
+    }
+    if (opts->stream) {
+        handoff_drain(&handoff);  /* the solver may have stopped early */
+        pthread_join(writer.thread, NULL);
+        /* an answer about part of the formula is worthless */
+        if (writer.ret != 0) {
+            code = RUN_SOLVER_ERR_MEMORY;
+        } else if (writer.write_ret != 0
+                   && (code == RUN_SOLVER_SAT || code == RUN_SOLVER_UNSAT))
+        {
+            code = RUN_SOLVER_ERR_STREAM;
+        }
+    }
+    handoff_close(&handoff);
+
+    if (winner >= 0 && opts->n_commands > 1 && opts->log != NULL) {
+        fprintf(opts->log, "Race won by: %s\n", opts->commands[winner]);
+    }
+    if (code == RUN_SOLVER_SAT) {
+        values[map.n_vars] = 0;
+        if (solver_model.n_dropped > sink.n_vars - map.n_vars) {
+            fprintf(stderr, "Solver reported %d unknown variables\n",
+                    solver_model.n_dropped - (sink.n_vars - map.n_vars));
+            code = RUN_SOLVER_ERR_STREAM;
+        } else {
+            _decode(sudoku, &map, values);
+        }
+    }
+    if (code != RUN_SOLVER_SAT) {
+        free(values);
+        values = NULL;
+    }
+    _give_model(model, &map, values);
+    return code;
+}
+
+
+/* Solves with a solver linked in; for the uniqueness the same solver
+ * instance is then asked for a second solution. */
+static RunSolverCode _solve_in_process(const Backend* backend,
+                                       Sudoku* sudoku,
+                                       const BackendOptions* opts,
+                                       const Deadline* deadline,
+                                       Uniqueness* uniqueness,
+                                       BackendModel* model)
+{
+    IncSolver solver;
+    if (inc_solver_init(&solver, backend->kind) != 0) {
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+
+    /* the solution ends up in `sudoku`, the blocking clause needs the
+     * puzzle as it was encoded */
+    const int check_unique = uniqueness != NULL;
+    Sudoku* puzzle = check_unique ? sudoku_clone(sudoku) : NULL;
+    VarMap map = { 0, NULL, NULL };
+    int* values = NULL;
+    RunSolverCode code = RUN_SOLVER_ERR_MEMORY;
+    if ((puzzle != NULL || !check_unique)
+        && _encode(&solver.sink, sudoku, opts, &map) == 0)
+    {
+        _log_formula_size(opts, &solver.sink);
+        if (check_unique) {
+            for (int v = 1; v <= map.n_vars; ++v) {
+                inc_solver_freeze(&solver, v);
+            }
+        }
+        values = _alloc_model(&map);
+        if (values != NULL) {
+            code = inc_solver_solve(&solver, values, map.n_vars, deadline);
+        }
+    }
+
+    if (code == RUN_SOLVER_SAT) {
+        _decode(sudoku, &map, values);
+        if (check_unique) {
+            *uniqueness = sudoku_check_unique(&solver, puzzle, sudoku, &map,
+                                              NULL, 0, deadline);
+        }
+    } else if (code == RUN_SOLVER_UNSAT && check_unique) {
+        *uniqueness = UNIQUENESS_NONE;
+    }
+
+    if (puzzle != NULL) {
+        sudoku_delete(puzzle);
+    }
+    inc_solver_release(&solver);
+    if (code != RUN_SOLVER_SAT) {
+        free(values);
+        values = NULL;
+    }
+    _give_model(model, &map, values);
+    return code;
+}
+
+
+/* Streams the solutions of `puzzle` from the same solver instance. */
+static RunSolverCode _enumerate_in_process(const Backend* backend,
+                                           const Sudoku* puzzle,
+                                           const BackendOptions* opts,
+                                           long limit, long* n_solutions,
+                                           SolutionReport report, void* data,
+                                           const Deadline* deadline)
+{
+    IncSolver solver;
+    if (inc_solver_init(&solver, backend->kind) != 0) {
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+
+    VarMap map = { 0, NULL, NULL };
+    RunSolverCode code = RUN_SOLVER_ERR_MEMORY;
+    if (_encode(&solver.sink, puzzle, opts, &map) == 0) {
+        _log_formula_size(opts, &solver.sink);
+        for (int v = 1; v <= map.n_vars; ++v) {  /* blocked later on */
+            inc_solver_freeze(&solver, v);
+        }
+        code = sudoku_enumerate(&solver, puzzle, &map, NULL, 0, limit,
+                                n_solutions, report, data, deadline);
+    }
+
+    var_map_release(&map);
+    inc_solver_release(&solver);
+    return code;
+}
+
+
+/* Native engine: no formula at all. */
+static RunSolverCode _solve_dlx(const Backend* backend, Sudoku* sudoku,
+                                const BackendOptions* opts,
+                                const Deadline* deadline,
+                                Uniqueness* uniqueness, BackendModel* model)
+{
+    (void)backend;
+    (void)opts;
+    if (model != NULL) {
+        memset(model, 0, sizeof(BackendModel));
+    }
+
+    long n_solutions = 0;
+    RunSolverCode code = dlx_solve(sudoku, uniqueness != NULL ? 2 : 1,
+                                   &n_solutions, deadline);
+    if (uniqueness != NULL && code != RUN_SOLVER_ERR_MEMORY) {
+        *uniqueness = backend_count_uniqueness(code, n_solutions, deadline);
+    }
+    return code;
+}
+
+
+static RunSolverCode _enumerate_dlx(const Backend* backend,
+                                    const Sudoku* puzzle,
+                                    const BackendOptions* opts, long limit,
+                                    long* n_solutions, SolutionReport report,
+                                    void* data, const Deadline* deadline)
+{
+    (void)backend;
+    (void)opts;
+    return dlx_enumerate(puzzle, limit, n_solutions, report, data,
+                         deadline);
+}
+
+
+static const Backend BACKENDS[] = {
+    {
+        .name = "picosat",
+        .engine = "SAT",
+        .caps = BACKEND_CAN_INCREMENTAL | BACKEND_CAN_ASSUME
+                | BACKEND_CAN_CANCEL | BACKEND_CAN_ENUMERATE
+                | BACKEND_USES_CNF | BACKEND_IN_PROCESS,
+        .kind = INC_SOLVER_PICOSAT,
+        .solve = _solve_in_process,
+        .enumerate = _enumerate_in_process,
+    },
+    {
+        .name = "glucose",
+        .engine = "SAT",
+        .caps = BACKEND_CAN_INCREMENTAL | BACKEND_CAN_ASSUME
+                | BACKEND_CAN_CANCEL | BACKEND_CAN_ENUMERATE
+                | BACKEND_USES_CNF | BACKEND_IN_PROCESS,
+        .kind = INC_SOLVER_GLUCOSE,
+        .solve = _solve_in_process,
+        .enumerate = _enumerate_in_process,
+    },
+    {
+        .name = "external",
+        .engine = "SAT",
+        .caps = BACKEND_CAN_CANCEL | BACKEND_USES_CNF,
+        .kind = INC_SOLVER_PICOSAT,  /* unused */
+        .solve = _solve_external,
+        .enumerate = NULL,
+    },
+    {
+        .name = "dlx",
+        .engine = "DLX",
+        .caps = BACKEND_CAN_CANCEL | BACKEND_CAN_ENUMERATE
+                | BACKEND_IN_PROCESS,
+        .kind = INC_SOLVER_PICOSAT,  /* unused */
+        .solve = _solve_dlx,
+        .enumerate = _enumerate_dlx,
+    },
+};
+
+#define N_BACKENDS ((int)(sizeof(BACKENDS) / sizeof(BACKENDS[0])))
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+const Backend* backend_find(const char* name)
+{
+    for (int b = 0; b < N_BACKENDS; ++b) {
+        if (strcmp(BACKENDS[b].name, name) == 0) {
+            return &BACKENDS[b];
+        }
+    }
+    return NULL;
+}
+
+
+const Backend* backend_pick(int n_values, unsigned caps)
+{
+    const Backend* dlx = backend_find("dlx");
+    if (n_values <= DLX_MAX_VALUES && (dlx->caps & caps) == caps) {
+        return dlx;
+    }
+    return backend_find("picosat");
+}
+
+
+Uniqueness backend_count_uniqueness(RunSolverCode code, long n_solutions,
+                                    const Deadline* deadline)
+{
+    if (n_solutions > 1) {
+        return UNIQUENESS_MULTIPLE;
+    } else if (code == RUN_SOLVER_UNSAT) {
+        return UNIQUENESS_NONE;
+    } else if (code == RUN_SOLVER_SAT && !deadline_expired(deadline)) {
+        return UNIQUENESS_UNIQUE;
+    }
+    return UNIQUENESS_UNKNOWN;
+}
+
+
+void backend_model_release(BackendModel* model)
+{
+    var_map_release(&model->map);
+    free(model->values);
+    model->values = NULL;
+}
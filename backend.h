@@ -0,0 +1,108 @@
+#ifndef _BACKEND_H_
+#define _BACKEND_H_
+
+#include <stdio.h>
+
+#include "deadline.h"
+#include "encoder.h"
+#include "inc_solver.h"
+#include "run_solver.h"
+#include "sudoku.h"
+#include "unique.h"
+
+/**
+ * What a backend can do (the first four) and how it works, Backend.caps.
+ */
+typedef enum {
+    BACKEND_CAN_INCREMENTAL = 1 << 0,  /* keeps a formula between solves */
+    BACKEND_CAN_ASSUME = 1 << 1,       /* solves under assumptions */
+    BACKEND_CAN_CANCEL = 1 << 2,       /* gives up mid-solve on a deadline */
+    BACKEND_CAN_ENUMERATE = 1 << 3,    /* lists and counts solutions */
+    BACKEND_USES_CNF = 1 << 4,         /* solves the CNF encoding */
+    BACKEND_IN_PROCESS = 1 << 5,       /* no child process nor file */
+} BackendCaps;
+
+/**
+ * Settings of a solve, those that do not apply to a backend are ignored.
+ */
+typedef struct
+{
+    AmoEncoding amo_encoding;
+    int prune;                    /* apply the fixed cells while encoding */
+    const char* const* commands;  /* external solvers, raced */
+    int n_commands;
+    const char* instance_file;    /* CNF for them, NULL: a memfd */
+    int stream;                   /* pipe the CNF to them as it is built */
+    FILE* log;                    /* formula size, race winner, NULL: none */
+} BackendOptions;
+
+/**
+ * Model of a CNF backend, for those who want to see it.
+ */
+typedef struct
+{
+    VarMap map;   /* cell variables of the encoding */
+    int* values;  /* map.n_vars + 1 entries, NULL if there is no model */
+} BackendModel;
+
+typedef struct Backend Backend;
+
+/**
+ * A way of solving sudokus. The frontend, the batch driver and the server
+ * go through it, so engines are picked at runtime by name or, with
+ * backend_pick, by grid size.
+ */
+struct Backend
+{
+    const char* name;    /* as given to -b */
+    const char* engine;  /* "SAT" or "DLX", as in "Finished by: SAT" */
+    unsigned caps;       /* BackendCaps */
+    IncSolverKind kind;  /* with BACKEND_CAN_INCREMENTAL */
+
+    /**
+     * Solves `sudoku`, whose cells receive the solution on
+     * RUN_SOLVER_SAT. If `uniqueness` is not NULL (only with
+     * BACKEND_CAN_ENUMERATE) it receives whether the solution is the only
+     * one. If `model` is not NULL a CNF backend stores its model there, to
+     * be released with backend_model_release.
+     */
+    RunSolverCode (*solve)(const Backend* backend, Sudoku* sudoku,
+                           const BackendOptions* opts,
+                           const Deadline* deadline, Uniqueness* uniqueness,
+                           BackendModel* model);
+
+    /**
+     * Passes the solutions of `puzzle`, up to `limit`, to `report` (if not
+     * NULL), see sudoku_enumerate. NULL without BACKEND_CAN_ENUMERATE.
+     */
+    RunSolverCode (*enumerate)(const Backend* backend, const Sudoku* puzzle,
+                               const BackendOptions* opts, long limit,
+                               long* n_solutions, SolutionReport report,
+                               void* data, const Deadline* deadline);
+};
+
+/**
+ * Returns the backend called `name` ("picosat", "glucose", "external" or
+ * "dlx"), or NULL if there is none.
+ */
+const Backend* backend_find(const char* name);
+
+/**
+ * Returns the fastest backend for grids of `n_values` values among those
+ * with all the `caps` (BackendCaps) asked for.
+ */
+const Backend* backend_pick(int n_values, unsigned caps);
+
+/**
+ * What a search for (at least) two solutions, which gave `code` and found
+ * `n_solutions` before `deadline`, says about uniqueness.
+ */
+Uniqueness backend_count_uniqueness(RunSolverCode code, long n_solutions,
+                                    const Deadline* deadline);
+
+/**
+ *
+ */
+void backend_model_release(BackendModel* model);
+
+#endif
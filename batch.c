@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "batch.h"
+#include "encoder.h"
+
+
+static void _batch_solver_delete(BatchSolver* solver)
+{
+    inc_solver_release(&solver->solver);
+    free(solver->model);
+    free(solver->lits);
+    free(solver);
+}
+
+
+static BatchSolver* _batch_solver_new(const BatchPool* pool,
+                                      const Sudoku* sudoku)
+{
+    BatchSolver* solver = (BatchSolver*)malloc(sizeof(BatchSolver));
+    if (solver == NULL) {
+        return NULL;
+    }
+
+    solver->region_n_rows = sudoku->region_n_rows;
+    solver->region_n_cols = sudoku->region_n_cols;
+    solver->n_vars = sudoku_encode_num_vars(sudoku);
+    solver->n_guards = 0;
+    solver->next = NULL;
+    solver->model = (int*)malloc((solver->n_vars + 1) * sizeof(int));
+    solver->lits = (int*)malloc(sudoku->n_cells * sizeof(int));
+    if (inc_solver_init(&solver->solver, pool->kind) != 0
+        || solver->model == NULL || solver->lits == NULL)
+    {
+        _batch_solver_delete(solver);
+        return NULL;
+    }
+
+    solver->solver.sink.amo_encoding = pool->amo_encoding;
+
+    /* every cell variable may be assumed later on */
+    for (int v = 1; v <= solver->n_vars; ++v) {
+        inc_solver_freeze(&solver->solver, v);
+    }
+    if (sudoku_encode_rules(&solver->solver.sink, sudoku) != 0) {
+        _batch_solver_delete(solver);
+        return NULL;
+    }
+
+    return solver;
+}
+
+
+void batch_pool_init(BatchPool* pool, IncSolverKind kind,
+                     AmoEncoding amo_encoding)
+{
+    pool->kind = kind;
+    pool->amo_encoding = amo_encoding;
+    pool->solvers = NULL;
+}
+
+
+BatchSolver* batch_pool_get(BatchPool* pool, const Sudoku* sudoku)
+{
+    BatchSolver** link = &pool->solvers;
+    while (*link != NULL
+           && ((*link)->region_n_rows != sudoku->region_n_rows
+               || (*link)->region_n_cols != sudoku->region_n_cols))
+    {
+        link = &(*link)->next;
+    }
+    if (*link != NULL && (*link)->n_guards < BATCH_MAX_GUARDS) {
+        return *link;
+    }
+
+    BatchSolver* solver = _batch_solver_new(pool, sudoku);
+    if (solver == NULL) {
+        return NULL;
+    }
+    if (*link != NULL) {  /* worn out by retired guards, replace it */
+        BatchSolver* old = *link;
+        solver->next = old->next;
+        *link = solver;
+        _batch_solver_delete(old);
+    } else {
+        solver->next = pool->solvers;
+        pool->solvers = solver;
+    }
+    return solver;
+}
+
+
+void batch_pool_release(BatchPool* pool)
+{
+    while (pool->solvers != NULL) {
+        BatchSolver* next = pool->solvers->next;
+        _batch_solver_delete(pool->solvers);
+        pool->solvers = next;
+    }
+}
+
+
+RunSolverCode batch_solve(BatchSolver* solver, Sudoku* sudoku,
+                          const Deadline* deadline)
+{
+    const int n_lits = sudoku_given_literals(sudoku, solver->lits);
+    for (int i = 0; i < n_lits; ++i) {
+        inc_solver_assume(&solver->solver, solver->lits[i]);
+    }
+
+    RunSolverCode code = inc_solver_solve(&solver->solver, solver->model,
+                                          solver->n_vars, deadline);
+    if (code == RUN_SOLVER_SAT) {
+        sudoku_decode_model(sudoku, solver->model);
+    }
+    return code;
+}
+
+
+Uniqueness batch_check_unique(BatchSolver* solver, const Sudoku* puzzle,
+                              const Sudoku* solution,
+                              const Deadline* deadline)
+{
+    const int n_lits = sudoku_given_literals(puzzle, solver->lits);
+    solver->n_guards += 1;
+    return sudoku_check_unique(&solver->solver, puzzle, solution, NULL,
+                               solver->lits, n_lits, deadline);
+}
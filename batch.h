@@ -0,0 +1,83 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "encoder.h"
+#include "inc_solver.h"
+#include "run_solver.h"
+#include "sudoku.h"
+#include "unique.h"
+
+/* uniqueness checks a solver serves before it is rebuilt */
+#define BATCH_MAX_GUARDS 4096
+
+/**
+ * Incremental solver holding the base encoding (cell, row, column and
+ * region constraints) of one sudoku shape. Puzzles of that shape are solved
+ * by assuming their fixed cells, so learnt clauses carry over from one
+ * puzzle to the next.
+ */
+typedef struct BatchSolver
+{
+    int region_n_rows;
+    int region_n_cols;
+    int n_vars;
+
+    IncSolver solver;
+    int* model;  /* n_vars + 1 entries */
+    int* lits;   /* one literal per cell */
+    int n_guards;  /* guard variables spent by batch_check_unique */
+
+    struct BatchSolver* next;
+} BatchSolver;
+
+/**
+ * Collection of batch solvers, one per shape seen so far.
+ */
+typedef struct
+{
+    IncSolverKind kind;
+    AmoEncoding amo_encoding;
+    BatchSolver* solvers;
+} BatchPool;
+
+/**
+ *
+ */
+void batch_pool_init(BatchPool* pool, IncSolverKind kind,
+                     AmoEncoding amo_encoding);
+
+/**
+ * Returns the solver for the shape of `sudoku`, building its base encoding
+ * the first time the shape is seen. Returns NULL if memory is exhausted.
+ *
+ * A solver that has spent BATCH_MAX_GUARDS guard variables on uniqueness
+ * checks is built anew, so the variables do not keep growing on long
+ * batches.
+ */
+BatchSolver* batch_pool_get(BatchPool* pool, const Sudoku* sudoku);
+
+/**
+ *
+ */
+void batch_pool_release(BatchPool* pool);
+
+/**
+ * Solves `sudoku` with `solver`, which must match its shape. On
+ * RUN_SOLVER_SAT the cells of `sudoku` are filled with the solution. Once
+ * `deadline` (if not NULL) is over the solve gives up with
+ * RUN_SOLVER_UNKNOWN.
+ */
+RunSolverCode batch_solve(BatchSolver* solver, Sudoku* sudoku,
+                          const Deadline* deadline);
+
+/**
+ * Tells whether `solution`, just found by batch_solve for `puzzle`, is its
+ * only solution, see sudoku_check_unique. The blocking clause is retired
+ * afterwards, so `solver` goes on serving other puzzles, but its guard
+ * variable stays behind (see batch_pool_get).
+ */
+Uniqueness batch_check_unique(BatchSolver* solver, const Sudoku* puzzle,
+                              const Sudoku* solution,
+                              const Deadline* deadline);
+
+#endif
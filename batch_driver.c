@@ -0,0 +1,437 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "batch_driver.h"
+#include "deadline.h"
+#include "presolve.h"
+#include "sudoku_reader.h"
+
+/* reorder buffer slots per worker, i.e. puzzles read ahead */
+#define JOBS_PER_WORKER 64
+
+
+/* A slot of the reorder buffer. */
+typedef struct
+{
+    BatchResult result;
+    int done;  /* result is final, guarded by BatchDriver.mutex */
+} Job;
+
+
+/* Queue of jobs of a worker, others may steal from it. */
+typedef struct
+{
+    pthread_mutex_t mutex;
+    Job** jobs;  /* ring of `capacity` entries */
+    int head;
+    int count;
+    int capacity;
+} JobQueue;
+
+
+typedef struct BatchDriver BatchDriver;
+
+typedef struct
+{
+    pthread_t thread;
+    BatchDriver* driver;
+    int id;
+    BatchPool pool;  /* solvers of this worker only */
+    JobQueue queue;
+} Worker;
+
+
+struct BatchDriver
+{
+    const BatchConfig* config;
+    Worker* workers;
+    int n_workers;
+    atomic_long n_queued;  /* jobs in any queue */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;  /* jobs queued or closing */
+    pthread_cond_t done_cond;  /* a job is done */
+    int closing;               /* no more jobs will be queued */
+};
+
+
+/***** Private functions *****/
+
+static int _queue_init(JobQueue* queue, int capacity)
+{
+    queue->jobs = (Job**)malloc(capacity * sizeof(Job*));
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = capacity;
+    pthread_mutex_init(&queue->mutex, NULL);
+    return queue->jobs == NULL ? -1 : 0;
+}
+
+
+static void _queue_release(JobQueue* queue)
+{
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->jobs);
+}
+
+
+static void _queue_push(JobQueue* queue, Job* job)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->jobs[(queue->head + queue->count) % queue->capacity] = job;
+    queue->count += 1;
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+
+/* Takes the oldest job of `queue`, the one the reorder buffer needs first,
+ * both for its owner and for thieves. */
+static Job* _queue_pop(BatchDriver* driver, JobQueue* queue)
+{
+    Job* job = NULL;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->count > 0) {
+        job = queue->jobs[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count -= 1;
+        atomic_fetch_sub(&driver->n_queued, 1);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return job;
+}
+
+
+static void* _worker_main(void* arg)
+{
+    Worker* worker = (Worker*)arg;
+    BatchDriver* driver = worker->driver;
+
+    for (;;) {
+        /* own queue first, then steal */
+        Job* job = _queue_pop(driver, &worker->queue);
+        for (int k = 1; job == NULL && k < driver->n_workers; ++k) {
+            Worker* victim = &driver->workers[(worker->id + k)
+                                              % driver->n_workers];
+            job = _queue_pop(driver, &victim->queue);
+        }
+
+        if (job == NULL) {
+            pthread_mutex_lock(&driver->mutex);
+            while (atomic_load(&driver->n_queued) <= 0 && !driver->closing) {
+                pthread_cond_wait(&driver->work_cond, &driver->mutex);
+            }
+            const int quit = atomic_load(&driver->n_queued) <= 0;
+            pthread_mutex_unlock(&driver->mutex);
+            if (quit) {
+                break;
+            }
+            continue;
+        }
+
+        batch_driver_solve(driver->config, &worker->pool, &job->result);
+
+        pthread_mutex_lock(&driver->mutex);
+        job->done = 1;
+        pthread_cond_signal(&driver->done_cond);
+        pthread_mutex_unlock(&driver->mutex);
+    }
+    return NULL;
+}
+
+
+/* Reports the finished jobs that are next in input order. Waits until at
+ * least `wait_until` jobs have been reported in total. */
+static void _report_ready(BatchDriver* driver, Job* ring, int window,
+                          long* n_out, long n_in, long wait_until,
+                          BatchReport report, void* data)
+{
+    while (*n_out < n_in) {
+        Job* job = &ring[*n_out % window];
+
+        pthread_mutex_lock(&driver->mutex);
+        while (!job->done && *n_out < wait_until) {
+            pthread_cond_wait(&driver->done_cond, &driver->mutex);
+        }
+        const int done = job->done;
+        pthread_mutex_unlock(&driver->mutex);
+
+        if (!done) {
+            break;
+        }
+        report(&job->result, data);
+        *n_out += 1;
+    }
+}
+
+
+static void _driver_stop(BatchDriver* driver, int n_started)
+{
+    pthread_mutex_lock(&driver->mutex);
+    driver->closing = 1;
+    pthread_cond_broadcast(&driver->work_cond);
+    pthread_mutex_unlock(&driver->mutex);
+
+    for (int w = 0; w < n_started; ++w) {
+        pthread_join(driver->workers[w].thread, NULL);
+    }
+}
+
+
+/* The backend of the puzzles of `n_values` values. */
+static const Backend* _backend_for(const BatchConfig* config, int n_values)
+{
+    return config->backend != NULL ? config->backend
+                                   : backend_pick(n_values, 0);
+}
+
+
+/* Whether `backend` solves with the per-shape solvers of `pool`. */
+static int _uses_pool(const Backend* backend, const BatchPool* pool)
+{
+    const unsigned caps = BACKEND_CAN_INCREMENTAL | BACKEND_CAN_ASSUME;
+    return (backend->caps & caps) == caps && backend->kind == pool->kind;
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+int batch_run(const BatchConfig* config, int n_files, char** files,
+              BatchReport report, void* data)
+{
+    BatchDriver driver;
+    memset(&driver, 0, sizeof(BatchDriver));
+    driver.config = config;
+    driver.n_workers = config->n_threads > 1 ? config->n_threads : 0;
+    atomic_init(&driver.n_queued, 0);
+    pthread_mutex_init(&driver.mutex, NULL);
+    pthread_cond_init(&driver.work_cond, NULL);
+    pthread_cond_init(&driver.done_cond, NULL);
+
+    /* without workers puzzles are solved right away, one slot is enough */
+    const int window = driver.n_workers > 0
+                       ? JOBS_PER_WORKER * driver.n_workers : 1;
+    Job* ring = (Job*)calloc(window, sizeof(Job));
+    driver.workers = (Worker*)calloc(driver.n_workers + 1, sizeof(Worker));
+    int ret = ring == NULL || driver.workers == NULL ? -1 : 0;
+    for (int s = 0; s < window && ret == 0; ++s) {
+        ring[s].result.sudoku = sudoku_new();
+        if (ring[s].result.sudoku == NULL) {
+            ret = -1;
+        }
+    }
+
+    BatchPool pool;  /* of the calling thread, when there are no workers */
+    batch_driver_pool_init(config, &pool);
+
+    /* every queue must exist before any worker may steal from it */
+    for (int w = 0; w < driver.n_workers && ret == 0; ++w) {
+        Worker* worker = &driver.workers[w];
+        worker->driver = &driver;
+        worker->id = w;
+        batch_driver_pool_init(config, &worker->pool);
+        if (_queue_init(&worker->queue, window) != 0) {
+            ret = -1;
+        }
+    }
+    int n_started = 0;
+    for (int w = 0; w < driver.n_workers && ret == 0; ++w) {
+        if (pthread_create(&driver.workers[w].thread, NULL, _worker_main,
+                           &driver.workers[w]) != 0)
+        {
+            ret = -1;
+            break;
+        }
+        n_started += 1;
+    }
+
+    long n_in = 0, n_out = 0;
+    for (int f = 0; f < n_files && ret == 0; ++f) {
+        SudokuReader reader;
+        int error_code = sudoku_reader_open(&reader, files[f]);
+
+        for (;;) {
+            /* the slot of the oldest puzzle must have been reported */
+            _report_ready(&driver, ring, window, &n_out, n_in,
+                          n_in - window + 1, report, data);
+            Job* job = &ring[n_in % window];
+            if (error_code == NO_ERROR) {
+                error_code = sudoku_reader_next(&reader, job->result.sudoku);
+                if (error_code == ERR_EOF) {
+                    break;
+                }
+            }
+
+            job->result.file = files[f];
+            job->result.line = reader.record_line;
+            job->result.error_code = error_code;
+            job->result.code = RUN_SOLVER_UNKNOWN;
+            job->result.stage = NULL;
+            job->done = 0;
+            n_in += 1;
+
+            if (error_code != NO_ERROR) {
+                job->done = 1;
+                if (reader.data == NULL) {  /* the file could not be read */
+                    job->result.line = 0;
+                    break;
+                }
+                error_code = NO_ERROR;  /* the reader goes on if it can */
+            } else if (driver.n_workers == 0) {
+                batch_driver_solve(config, &pool, &job->result);
+                job->done = 1;
+            } else {
+                atomic_fetch_add(&driver.n_queued, 1);
+                _queue_push(&driver.workers[n_in % driver.n_workers].queue,
+                            job);
+                pthread_mutex_lock(&driver.mutex);
+                pthread_cond_signal(&driver.work_cond);
+                pthread_mutex_unlock(&driver.mutex);
+            }
+            _report_ready(&driver, ring, window, &n_out, n_in, 0, report,
+                          data);
+        }
+        if (reader.data != NULL) {
+            sudoku_reader_close(&reader);
+        }
+    }
+    if (ret == 0) {
+        _report_ready(&driver, ring, window, &n_out, n_in, n_in, report,
+                      data);
+    }
+
+    _driver_stop(&driver, n_started);
+    for (int w = 0; w < driver.n_workers && driver.workers != NULL; ++w) {
+        batch_pool_release(&driver.workers[w].pool);
+        if (driver.workers[w].queue.jobs != NULL) {
+            _queue_release(&driver.workers[w].queue);
+        }
+    }
+    batch_pool_release(&pool);
+    for (int s = 0; s < window && ring != NULL; ++s) {
+        if (ring[s].result.sudoku != NULL) {
+            sudoku_delete(ring[s].result.sudoku);
+        }
+    }
+    free(ring);
+    free(driver.workers);
+    pthread_cond_destroy(&driver.work_cond);
+    pthread_cond_destroy(&driver.done_cond);
+    pthread_mutex_destroy(&driver.mutex);
+    return ret;
+}
+
+
+void batch_driver_pool_init(const BatchConfig* config, BatchPool* pool)
+{
+    const unsigned caps = BACKEND_CAN_INCREMENTAL | BACKEND_CAN_ASSUME;
+    const Backend* backend = config->backend;
+    if (backend == NULL || (backend->caps & caps) != caps) {
+        backend = backend_pick(SUDOKU_MAX_VALUES, caps);
+    }
+    batch_pool_init(pool, backend->kind, config->amo_encoding);
+}
+
+
+void batch_driver_warm(const BatchConfig* config, BatchPool* pool,
+                       int region_n_rows, int region_n_cols)
+{
+    const int n_values = region_n_rows * region_n_cols;
+    if (!_uses_pool(_backend_for(config, n_values), pool)) {
+        return;
+    }
+
+    Sudoku* shape = sudoku_new();
+    if (shape != NULL
+        && sudoku_init(shape, region_n_rows, region_n_cols) == NO_ERROR)
+    {
+        batch_pool_get(pool, shape);
+    }
+    if (shape != NULL) {
+        sudoku_delete(shape);
+    }
+}
+
+
+void batch_driver_solve(const BatchConfig* config, BatchPool* pool,
+                        BatchResult* result)
+{
+    Deadline deadline;
+    deadline_set(&deadline, config->timeout);
+
+    Sudoku* sudoku = result->sudoku;
+    const Backend* backend = _backend_for(config, sudoku->n_values);
+    result->code = RUN_SOLVER_ERR_MEMORY;
+    result->stage = "sat";
+    result->uniqueness = UNIQUENESS_UNKNOWN;
+
+    /* keyed before the presolver fills cells in */
+    CacheKey key;
+    const int keyed = config->cache != NULL
+                      && cache_key_init(&key, sudoku) == 0;
+    if (keyed && solution_cache_get(config->cache, &key, sudoku, sudoku,
+                                    config->check_unique,
+                                    &result->uniqueness))
+    {
+        result->code = RUN_SOLVER_SAT;
+        result->stage = "cache";
+        cache_key_release(&key);
+        return;
+    }
+
+    PresolveResult pr = PRESOLVE_REDUCED;
+    if (config->presolve) {
+        pr = sudoku_presolve(sudoku, NULL);
+    }
+
+    if (pr == PRESOLVE_SOLVED || pr == PRESOLVE_CONTRADICTION) {
+        /* singles are forced moves, a grid they fill has no alternative */
+        result->code = pr == PRESOLVE_SOLVED ? RUN_SOLVER_SAT
+                                             : RUN_SOLVER_UNSAT;
+        result->stage = "presolve";
+        result->uniqueness = pr == PRESOLVE_SOLVED ? UNIQUENESS_UNIQUE
+                                                   : UNIQUENESS_NONE;
+    } else if (pr == PRESOLVE_REDUCED && !_uses_pool(backend, pool)) {
+        /* whole puzzle solves, the backend checks the uniqueness itself */
+        BackendOptions opts = {
+            .amo_encoding = config->amo_encoding,
+            .log = NULL,
+        };
+        result->code = backend->solve(backend, sudoku, &opts, &deadline,
+                                      config->check_unique
+                                      ? &result->uniqueness : NULL,
+                                      NULL);
+        result->stage = backend->caps & BACKEND_USES_CNF ? "sat" : "dlx";
+    } else if (pr == PRESOLVE_REDUCED) {
+        BatchSolver* solver = batch_pool_get(pool, sudoku);
+        /* the solution overwrites the cells, the check needs the puzzle */
+        Sudoku* puzzle = config->check_unique ? sudoku_clone(sudoku) : NULL;
+        if (solver != NULL && (puzzle != NULL || !config->check_unique)) {
+            result->code = batch_solve(solver, sudoku, &deadline);
+        }
+        if (result->code == RUN_SOLVER_SAT && puzzle != NULL) {
+            result->uniqueness = batch_check_unique(solver, puzzle, sudoku,
+                                                    &deadline);
+        } else if (result->code == RUN_SOLVER_UNSAT) {
+            result->uniqueness = UNIQUENESS_NONE;
+        }
+        if (puzzle != NULL) {
+            sudoku_delete(puzzle);
+        }
+    }
+
+    if (keyed) {
+        if (result->code == RUN_SOLVER_SAT) {
+            /* without the check dlx stops at one solution, unchecked */
+            solution_cache_put(config->cache, &key, sudoku,
+                               config->check_unique ? result->uniqueness
+                                                    : UNIQUENESS_UNKNOWN);
+        }
+        cache_key_release(&key);
+    }
+}
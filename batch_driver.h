@@ -0,0 +1,84 @@
+#ifndef _BATCH_DRIVER_H_
+#define _BATCH_DRIVER_H_
+
+#include "backend.h"
+#include "batch.h"
+#include "encoder.h"
+#include "run_solver.h"
+#include "solution_cache.h"
+#include "sudoku.h"
+#include "unique.h"
+
+/**
+ * How the batch driver solves each puzzle.
+ */
+typedef struct
+{
+    const Backend* backend;    /* NULL: the fastest for each grid size */
+    AmoEncoding amo_encoding;
+    int presolve;              /* run the logic presolver first */
+    double timeout;            /* seconds per puzzle, 0: no deadline */
+    int n_threads;             /* workers, 1 solves in the calling thread */
+    int check_unique;          /* look for a second solution too */
+    SolutionCache* cache;      /* solved grids, NULL: none */
+} BatchConfig;
+
+/**
+ * Outcome of one puzzle (or of a file that could not be read).
+ */
+typedef struct
+{
+    const char* file;
+    long line;            /* where the puzzle starts, 0 for file errors */
+    int error_code;       /* of the reader, NO_ERROR if the puzzle loaded */
+    RunSolverCode code;
+    const char* stage;    /* "cache", "presolve", "dlx" or "sat" */
+    Sudoku* sudoku;       /* filled in place on RUN_SOLVER_SAT */
+    Uniqueness uniqueness;  /* with BatchConfig.check_unique only */
+} BatchResult;
+
+typedef void (*BatchReport)(const BatchResult* result, void* data);
+
+/**
+ * Solves every puzzle of `files` (see sudoku_reader.h for the formats)
+ * and calls `report` with each result, from the calling thread and in
+ * input order.
+ *
+ * With several threads the calling thread reads the puzzles and deals them
+ * out to the workers, each with its own queue, its own BatchPool (so its
+ * own solvers and encoder buffers) and the right to steal from the other
+ * queues when its own runs dry. Finished puzzles wait in a reorder buffer
+ * until every earlier one has been reported; reading stops while that
+ * buffer is full, which bounds the memory in use.
+ *
+ * With a cache, puzzles equivalent to one solved before are answered from
+ * it, and every grid solved is stored in it.
+ *
+ * Returns 0 on success, -1 if memory or threads could not be obtained.
+ */
+int batch_run(const BatchConfig* config, int n_files, char** files,
+              BatchReport report, void* data);
+
+/**
+ * Sets up `pool` for the incremental solver `config` asks for (or picks).
+ */
+void batch_driver_pool_init(const BatchConfig* config, BatchPool* pool);
+
+/**
+ * Builds the base encoding of the shape with regions of `region_n_rows`
+ * by `region_n_cols` in `pool`, if puzzles of that shape will use it.
+ */
+void batch_driver_warm(const BatchConfig* config, BatchPool* pool,
+                       int region_n_rows, int region_n_cols);
+
+/**
+ * Solves the puzzle in `result->sudoku` as batch_run does and fills in
+ * `result->code`, `stage` and `uniqueness`. Incremental backends use the
+ * solvers of `pool` (set up with batch_driver_pool_init), the others get
+ * the puzzle as a whole. For callers that deal the puzzles out
+ * themselves; a pool is used by one thread at a time.
+ */
+void batch_driver_solve(const BatchConfig* config, BatchPool* pool,
+                        BatchResult* result);
+
+#endif
@@ -0,0 +1,619 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cnf_sink.h"
+#include "encoder.h"
+#include "run_solver.h"
+#include "sudoku.h"
+
+/*
+ * Per-stage benchmark of the file based pipeline: parse the puzzle, encode
+ * it, write instance.cnf, spawn the external solver, solve, decode and
+ * print the solution. Each instance runs in a child process of its own, so
+ * the peak RSS reported belongs to that instance only.
+ */
+
+typedef enum {
+    STAGE_PARSE,
+    STAGE_ENCODE,  /* clauses generated into a counting sink */
+    STAGE_WRITE,   /* clauses generated again, into the DIMACS writer */
+    STAGE_SPAWN,   /* startup of the solver on a trivial instance */
+    STAGE_SOLVE,   /* solver run minus STAGE_SPAWN */
+    STAGE_DECODE,  /* model decoding and sudoku_print */
+    N_STAGES,
+} Stage;
+
+static const char* STAGE_NAMES[N_STAGES] = {
+    "parse", "encode", "write", "spawn", "solve", "decode",
+};
+
+
+#define NAME_SIZE 64
+
+/* runs of the trivial instance that measures the solver startup */
+#define SPAWN_RUNS 10
+
+typedef struct
+{
+    char name[NAME_SIZE];
+    int n_values;
+    int n_givens;
+    int n_vars;
+    int64_t n_clauses;
+    long cnf_bytes;
+    double ms[N_STAGES];
+    double total_ms;
+    long rss_kb;         /* peak of the benchmark process */
+    long solver_rss_kb;  /* peak of the solver process */
+    int code;            /* RunSolverCode, -1 if an earlier stage failed */
+} BenchRecord;
+
+
+typedef struct
+{
+    const char* solver;
+    AmoEncoding amo_encoding;
+    int prune;
+    int n_runs;          /* per instance, the fastest one is kept */
+    int max_side;        /* synthetic grids up to max_side^2 values */
+    double keep;         /* share of givens of the synthetic grids */
+    const char* work_dir;
+    int json;
+    const char* baseline;
+    double tolerance;    /* allowed slowdown against the baseline, in % */
+    double noise_ms;     /* slowdowns below this are never regressions */
+} BenchOptions;
+
+
+/***** Private functions *****/
+
+static double _now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+
+/* Same encodings as the sudoku program. */
+static int _encode(CnfSink* sink, const Sudoku* sudoku,
+                   const BenchOptions* opts, VarMap* map)
+{
+    sink->amo_encoding = opts->amo_encoding;
+    if (opts->prune) {
+        return sudoku_encode_pruned(sink, sudoku, map);
+    }
+    map->n_vars = sudoku_encode_num_vars(sudoku);
+    map->first = NULL;
+    map->value_of = NULL;
+    return sudoku_encode(sink, sudoku);
+}
+
+
+/* Time of a solver run on a formula that takes no solving at all. */
+static double _spawn_ms(const BenchOptions* opts)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/sudoku_bench_%d_trivial.cnf",
+             opts->work_dir, (int)getpid());
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return 0;
+    }
+    fputs("p cnf 1 1\n1 0\n", f);
+    fclose(f);
+
+    double best = -1;
+    for (int r = 0; r < SPAWN_RUNS; ++r) {
+        const double start = _now_ms();
+        run_solver(opts->solver, path, NULL, NULL);
+        const double ms = _now_ms() - start;
+        if (best < 0 || ms < best) {
+            best = ms;
+        }
+    }
+    unlink(path);
+    return best;
+}
+
+
+/* Runs every stage once on the puzzle at `path`. */
+static void _run_stages(const char* path, const BenchOptions* opts,
+                        double spawn_ms, BenchRecord* rec)
+{
+    rec->code = -1;
+    double t = _now_ms();
+    Sudoku* sudoku = sudoku_new();
+    if (sudoku == NULL || sudoku_parse_file(path, sudoku) != NO_ERROR) {
+        return;
+    }
+    rec->ms[STAGE_PARSE] = _now_ms() - t;
+    rec->n_values = sudoku->n_values;
+    rec->n_givens = sudoku->n_fixed_cells;
+
+    t = _now_ms();
+    CnfSink sink;
+    cnf_sink_init_counter(&sink);
+    VarMap map = { 0, NULL, NULL };
+    int ret = _encode(&sink, sudoku, opts, &map);
+    var_map_release(&map);
+    rec->ms[STAGE_ENCODE] = _now_ms() - t;
+    rec->n_vars = sink.n_vars;
+    rec->n_clauses = sink.n_clauses;
+
+    char cnf_path[PATH_MAX];
+    snprintf(cnf_path, sizeof(cnf_path), "%s/sudoku_bench_%d.cnf",
+             opts->work_dir, (int)getpid());
+    t = _now_ms();
+    int fd = open(cnf_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (ret != 0 || fd < 0 || cnf_sink_open_writer(&sink, fd) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        sudoku_delete(sudoku);
+        return;
+    }
+    ret = _encode(&sink, sudoku, opts, &map);
+    if (cnf_sink_close_writer(&sink) != 0) {
+        ret = -1;
+    }
+    close(fd);
+    rec->ms[STAGE_WRITE] = _now_ms() - t;
+
+    struct stat st;
+    rec->cnf_bytes = stat(cnf_path, &st) == 0 ? (long)st.st_size : 0;
+
+    int* model = (int*)malloc((map.n_vars + 1) * sizeof(int));
+    if (ret == 0 && model != NULL) {
+        SolverModel solver_model = { model, map.n_vars, 0, 0 };
+        t = _now_ms();
+        RunSolverCode code = run_solver(opts->solver, cnf_path,
+                                        &solver_model, NULL);
+        const double run_ms = _now_ms() - t;
+        rec->ms[STAGE_SPAWN] = spawn_ms < run_ms ? spawn_ms : run_ms;
+        rec->ms[STAGE_SOLVE] = run_ms - rec->ms[STAGE_SPAWN];
+        rec->code = code;
+    }
+    unlink(cnf_path);
+
+    if (rec->code == RUN_SOLVER_SAT) {
+        t = _now_ms();
+        model[map.n_vars] = 0;
+        if (map.first != NULL) {
+            sudoku_decode_pruned(sudoku, &map, model);
+        } else {
+            sudoku_decode_model(sudoku, model);
+        }
+        FILE* null_out = fopen("/dev/null", "w");
+        if (null_out != NULL) {
+            sudoku_print(null_out, sudoku);
+            fclose(null_out);
+        }
+        rec->ms[STAGE_DECODE] = _now_ms() - t;
+    }
+
+    for (int s = 0; s < N_STAGES; ++s) {
+        rec->total_ms += rec->ms[s];
+    }
+    free(model);
+    var_map_release(&map);
+    sudoku_delete(sudoku);
+}
+
+
+/* Runs the stages in a child process and collects its record. */
+static int _run_isolated(const char* path, const BenchOptions* opts,
+                         double spawn_ms, BenchRecord* rec)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    } else if (pid == 0) {
+        close(fds[0]);
+        _run_stages(path, opts, spawn_ms, rec);
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        rec->rss_kb = usage.ru_maxrss;
+        getrusage(RUSAGE_CHILDREN, &usage);
+        rec->solver_rss_kb = usage.ru_maxrss;
+
+        const ssize_t n = write(fds[1], rec, sizeof(BenchRecord));
+        _exit(n == (ssize_t)sizeof(BenchRecord) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    size_t n_read = 0;
+    while (n_read < sizeof(BenchRecord)) {
+        const ssize_t n = read(fds[0], (char*)rec + n_read,
+                               sizeof(BenchRecord) - n_read);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            break;
+        }
+        n_read += (size_t)n;
+    }
+    close(fds[0]);
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return n_read == sizeof(BenchRecord) ? 0 : -1;
+}
+
+
+/* Runs an instance `opts->n_runs` times, keeping the fastest time of each
+ * stage and the biggest peak RSS. */
+static int _bench_instance(const char* path, const char* name,
+                           const BenchOptions* opts, double spawn_ms,
+                           BenchRecord* best)
+{
+    for (int r = 0; r < opts->n_runs; ++r) {
+        BenchRecord rec;
+        memset(&rec, 0, sizeof(BenchRecord));
+        if (_run_isolated(path, opts, spawn_ms, &rec) != 0) {
+            return -1;
+        }
+        if (r == 0) {
+            *best = rec;
+            continue;
+        }
+        if (rec.code != RUN_SOLVER_SAT && rec.code != RUN_SOLVER_UNSAT) {
+            best->code = rec.code;  /* one failed run spoils the instance */
+        }
+        for (int s = 0; s < N_STAGES; ++s) {
+            if (rec.ms[s] < best->ms[s]) {
+                best->ms[s] = rec.ms[s];
+            }
+        }
+        if (rec.total_ms < best->total_ms) {
+            best->total_ms = rec.total_ms;
+        }
+        if (rec.rss_kb > best->rss_kb) {
+            best->rss_kb = rec.rss_kb;
+        }
+        if (rec.solver_rss_kb > best->solver_rss_kb) {
+            best->solver_rss_kb = rec.solver_rss_kb;
+        }
+    }
+    snprintf(best->name, NAME_SIZE, "%s", name);
+    return 0;
+}
+
+
+/* Writes a grid with regions of side x side cells, every value shifted
+ * along the rows, with a share `keep` of its cells given. */
+static int _write_synthetic(const char* path, int side, double keep,
+                            unsigned seed)
+{
+    Sudoku* sudoku = sudoku_new();
+    if (sudoku == NULL || sudoku_init(sudoku, side, side) != NO_ERROR) {
+        return -1;
+    }
+
+    const int n = sudoku->n_values;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if (rand_r(&seed) < keep * ((double)RAND_MAX + 1)) {
+                sudoku_set(sudoku, i, j,
+                           (side * (i % side) + i / side + j) % n + 1);
+            }
+        }
+    }
+
+    FILE* f = fopen(path, "w");
+    int ret = f == NULL ? -1 : sudoku_write(f, sudoku);
+    if (f != NULL && fclose(f) != 0) {
+        ret = -1;
+    }
+    sudoku_delete(sudoku);
+    return ret == NO_ERROR ? 0 : -1;
+}
+
+
+static const char* _code_name(int code)
+{
+    switch (code) {
+        case RUN_SOLVER_SAT:
+            return "SAT";
+        case RUN_SOLVER_UNSAT:
+            return "UNSAT";
+        case RUN_SOLVER_UNKNOWN:
+            return "UNKNOWN";
+        default:
+            return "ERROR";
+    }
+}
+
+
+static void _print_csv_header(FILE* out)
+{
+    fputs("name,n_values,n_givens,n_vars,n_clauses,cnf_bytes", out);
+    for (int s = 0; s < N_STAGES; ++s) {
+        fprintf(out, ",%s_ms", STAGE_NAMES[s]);
+    }
+    fputs(",total_ms,rss_kb,solver_rss_kb,result\n", out);
+}
+
+
+static void _print_csv(FILE* out, const BenchRecord* rec)
+{
+    fprintf(out, "%s,%d,%d,%d,%" PRId64 ",%ld", rec->name, rec->n_values,
+            rec->n_givens, rec->n_vars, rec->n_clauses, rec->cnf_bytes);
+    for (int s = 0; s < N_STAGES; ++s) {
+        fprintf(out, ",%.3f", rec->ms[s]);
+    }
+    fprintf(out, ",%.3f,%ld,%ld,%s\n", rec->total_ms, rec->rss_kb,
+            rec->solver_rss_kb, _code_name(rec->code));
+}
+
+
+static void _print_json(FILE* out, const BenchRecord* rec, int first)
+{
+    fprintf(out, "%s  {\"name\": \"%s\", \"n_values\": %d, "
+            "\"n_givens\": %d, \"n_vars\": %d, \"n_clauses\": %" PRId64 ", "
+            "\"cnf_bytes\": %ld,\n   \"ms\": {", first ? "" : ",\n",
+            rec->name, rec->n_values, rec->n_givens, rec->n_vars,
+            rec->n_clauses, rec->cnf_bytes);
+    for (int s = 0; s < N_STAGES; ++s) {
+        fprintf(out, "%s\"%s\": %.3f", s == 0 ? "" : ", ", STAGE_NAMES[s],
+                rec->ms[s]);
+    }
+    fprintf(out, "},\n   \"total_ms\": %.3f, \"rss_kb\": %ld, "
+            "\"solver_rss_kb\": %ld, \"result\": \"%s\"}", rec->total_ms,
+            rec->rss_kb, rec->solver_rss_kb, _code_name(rec->code));
+}
+
+
+/* Looks for `name` in a CSV written by this program and reads its total
+ * time and formula size. Returns 0 if it is there. */
+static int _baseline_lookup(FILE* baseline, const char* name,
+                            double* total_ms, int* n_vars,
+                            int64_t* n_clauses)
+{
+    char line[1024];
+    rewind(baseline);
+    while (fgets(line, sizeof(line), baseline) != NULL) {
+        char* save;
+        char* field = strtok_r(line, ",", &save);
+        if (field == NULL || strcmp(field, name) != 0) {
+            continue;
+        }
+
+        /* n_values, n_givens, n_vars, n_clauses, cnf_bytes, stages */
+        double values[5 + N_STAGES + 1];
+        int n_fields = 0;
+        while (n_fields < 5 + N_STAGES + 1
+               && (field = strtok_r(NULL, ",", &save)) != NULL)
+        {
+            values[n_fields++] = atof(field);
+        }
+        if (n_fields < 5 + N_STAGES + 1) {
+            return -1;
+        }
+        *n_vars = (int)values[2];
+        *n_clauses = (int64_t)values[3];
+        *total_ms = values[5 + N_STAGES];
+        return 0;
+    }
+    return -1;
+}
+
+
+/* Compares `rec` with the baseline, returns 1 if it regressed. */
+static int _check_regression(FILE* baseline, const BenchRecord* rec,
+                             const BenchOptions* opts)
+{
+    double base_ms;
+    int base_vars;
+    int64_t base_clauses;
+    if (_baseline_lookup(baseline, rec->name, &base_ms, &base_vars,
+                         &base_clauses) != 0)
+    {
+        fprintf(stderr, "%s: not in the baseline\n", rec->name);
+        return 0;
+    }
+
+    int regressed = 0;
+    if (rec->n_vars != base_vars || rec->n_clauses != base_clauses) {
+        fprintf(stderr, "%s: formula changed, %d vars %" PRId64 " clauses "
+                "(baseline %d vars %" PRId64 " clauses)\n", rec->name,
+                rec->n_vars, rec->n_clauses, base_vars, base_clauses);
+    }
+    const double limit = base_ms * (1 + opts->tolerance / 100);
+    if (rec->total_ms > limit && rec->total_ms - base_ms > opts->noise_ms) {
+        fprintf(stderr, "%s: REGRESSION %.3f ms (baseline %.3f ms, "
+                "%+.1f%%)\n", rec->name, rec->total_ms, base_ms,
+                100 * (rec->total_ms - base_ms) / base_ms);
+        regressed = 1;
+    }
+    return regressed;
+}
+
+
+static void _usage(const char* prog)
+{
+    printf("Usage: %s [-c <command>] [-a <amo>] [-p] [-r <runs>] "
+           "[-m <side>] [-k <share>]\n"
+           "          [-w <dir>] [-j] [-B <baseline.csv>] [-T <percent>] "
+           "[<sudoku_file>...]\n"
+           "  -c  external solver (default: "
+           "solvers/picosat-965/picosat)\n"
+           "  -a  at-most-one encoding, -p prunes, as in the sudoku "
+           "program\n"
+           "  -r  runs per instance, the fastest is kept (default: 3)\n"
+           "  -m  synthetic grids of 3x3 regions up to <side>x<side> "
+           "(default: 8,\n"
+           "      64x64 values; without -p that takes GBs of CNF), 0 for "
+           "none\n"
+           "  -k  share of givens of the synthetic grids (default: 0.75)\n"
+           "  -w  directory for the temporary files (default: /tmp)\n"
+           "  -j  JSON output instead of CSV\n"
+           "  -B  compare the total times with a CSV written before, exit "
+           "with 1 if\n"
+           "      one is more than <percent> (default: 20) slower\n",
+           prog);
+}
+
+
+int main(int argc, char** argv)
+{
+    BenchOptions opts = {
+        .solver = "solvers/picosat-965/picosat",
+        .amo_encoding = AMO_PAIRWISE,
+        .prune = 0,
+        .n_runs = 3,
+        .max_side = 8,
+        .keep = 0.75,
+        .work_dir = "/tmp",
+        .json = 0,
+        .baseline = NULL,
+        .tolerance = 20,
+        .noise_ms = 1,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:a:pr:m:k:w:jB:T:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                opts.solver = optarg;
+                break;
+            case 'a':
+                opts.amo_encoding = amo_encoding_from_name(optarg);
+                if (opts.amo_encoding == AMO_INVALID) {
+                    printf("Error: unknown AMO encoding '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                opts.prune = 1;
+                break;
+            case 'r':
+                opts.n_runs = atoi(optarg);
+                break;
+            case 'm':
+                opts.max_side = atoi(optarg);
+                break;
+            case 'k':
+                opts.keep = atof(optarg);
+                break;
+            case 'w':
+                opts.work_dir = optarg;
+                break;
+            case 'j':
+                opts.json = 1;
+                break;
+            case 'B':
+                opts.baseline = optarg;
+                break;
+            case 'T':
+                opts.tolerance = atof(optarg);
+                break;
+            default:
+                _usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (opts.n_runs <= 0 || opts.keep < 0 || opts.keep > 1) {
+        _usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE* baseline = NULL;
+    if (opts.baseline != NULL) {
+        baseline = fopen(opts.baseline, "r");
+        if (baseline == NULL) {
+            printf("Error: %s: %s\n", opts.baseline, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    const double spawn_ms = _spawn_ms(&opts);
+    if (opts.json) {
+        printf("[\n");
+    } else {
+        _print_csv_header(stdout);
+    }
+
+    int n_done = 0, n_failed = 0, n_regressed = 0;
+    const int n_files = argc - optind;
+    const int n_synthetic = opts.max_side >= 3 ? opts.max_side - 2 : 0;
+    for (int b = 0; b < n_files + n_synthetic; ++b) {
+        char path[PATH_MAX];
+        char name[NAME_SIZE];
+        if (b < n_files) {
+            snprintf(path, sizeof(path), "%s", argv[optind + b]);
+            snprintf(name, sizeof(name), "%s", basename(path));
+            /* basename may have cut `path` */
+            snprintf(path, sizeof(path), "%s", argv[optind + b]);
+        } else {
+            const int side = 3 + b - n_files;
+            snprintf(name, sizeof(name), "synthetic-%dx%d", side * side,
+                     side * side);
+            snprintf(path, sizeof(path), "%s/sudoku_bench_%d.sdk",
+                     opts.work_dir, (int)getpid());
+            if (_write_synthetic(path, side, opts.keep, side) != 0) {
+                fprintf(stderr, "%s: could not be written\n", name);
+                n_failed += 1;
+                continue;
+            }
+        }
+
+        BenchRecord rec;
+        const int ret = _bench_instance(path, name, &opts, spawn_ms, &rec);
+        if (b >= n_files) {
+            unlink(path);
+        }
+        /* an UNKNOWN or a solver that failed timed nothing worth keeping */
+        if (ret != 0
+            || (rec.code != RUN_SOLVER_SAT && rec.code != RUN_SOLVER_UNSAT))
+        {
+            fprintf(stderr, "%s: failed (%s)\n", name,
+                    ret != 0 ? "not run" : _code_name(rec.code));
+            n_failed += 1;
+            continue;
+        }
+
+        if (opts.json) {
+            _print_json(stdout, &rec, n_done == 0);
+        } else {
+            _print_csv(stdout, &rec);
+        }
+        fflush(stdout);
+        n_done += 1;
+        if (baseline != NULL) {
+            n_regressed += _check_regression(baseline, &rec, &opts);
+        }
+    }
+    if (opts.json) {
+        printf("\n]\n");
+    }
+
+    if (baseline != NULL) {
+        fclose(baseline);
+        fprintf(stderr, "%d regressions against %s\n", n_regressed,
+                opts.baseline);
+    }
+    return n_failed == 0 && n_regressed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
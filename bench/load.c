@@ -0,0 +1,426 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Load test of the solve server (sudoku -D <socket>): a number of clients
+ * connect at once and send one-line puzzles, each keeping up to a given
+ * number of requests in flight, and the throughput and the latency of the
+ * answers are reported. Answers whose solution does not keep the givens of
+ * their puzzle are counted as wrong.
+ */
+
+#define READ_SIZE 65536
+
+typedef enum {
+    ANSWER_SAT,
+    ANSWER_UNSAT,
+    ANSWER_UNKNOWN,
+    ANSWER_ERROR,
+    ANSWER_WRONG,  /* SAT, but not a solution of the puzzle sent */
+    N_ANSWERS,
+} Answer;
+
+static const char* ANSWER_NAMES[N_ANSWERS] = {
+    "SAT", "UNSAT", "UNKNOWN", "ERROR", "wrong",
+};
+
+
+typedef struct
+{
+    const char* socket_path;
+    int n_clients;
+    int depth;         /* requests in flight per client */
+    long n_requests;   /* per client, 0: the whole file once */
+    char** puzzles;
+    size_t* lengths;
+    long n_puzzles;
+} LoadOptions;
+
+
+typedef struct
+{
+    pthread_t thread;
+    const LoadOptions* opts;
+    int id;
+    long n_requests;
+    double* latencies;  /* ms, one per answer */
+    long n_answers;
+    long counts[N_ANSWERS];
+    int failed;         /* connection lost or refused */
+} LoadClient;
+
+
+/***** Private functions *****/
+
+static double _now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+
+static void _usage(const char* prog)
+{
+    printf("Usage: %s [-c <clients>] [-d <depth>] [-n <requests>] <socket> "
+           "<puzzle_file>\n"
+           "  -c  clients connected at once (default: 4)\n"
+           "  -d  requests in flight per client (default: 16)\n"
+           "  -n  requests per client (default: every puzzle of the file "
+           "once)\n"
+           "The puzzles are one-line sudokus, one per line; the clients "
+           "start at\n"
+           "different places of the file and wrap around.\n", prog);
+}
+
+
+/* Loads the non blank, non comment lines of `path`. */
+static int _load_puzzles(const char* path, LoadOptions* opts)
+{
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    long capacity = 0;
+    while ((len = getline(&line, &size, f)) >= 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'
+                           || line[len - 1] == ' '))
+        {
+            len -= 1;
+        }
+        if (len == 0 || line[0] == '#') {
+            continue;
+        }
+        if (opts->n_puzzles == capacity) {
+            capacity = capacity > 0 ? 2 * capacity : 1024;
+            opts->puzzles = (char**)realloc(opts->puzzles,
+                                            capacity * sizeof(char*));
+            opts->lengths = (size_t*)realloc(opts->lengths,
+                                             capacity * sizeof(size_t));
+            if (opts->puzzles == NULL || opts->lengths == NULL) {
+                break;
+            }
+        }
+        opts->puzzles[opts->n_puzzles] = strndup(line, (size_t)len);
+        opts->lengths[opts->n_puzzles] = (size_t)len;
+        opts->n_puzzles += 1;
+    }
+    free(line);
+    fclose(f);
+    return opts->puzzles != NULL && opts->lengths != NULL ? 0 : -1;
+}
+
+
+/* Sorts the answer line `line` (without its newline) to the puzzle it
+ * answers. */
+static Answer _classify(const char* line, size_t len, const char* puzzle,
+                        size_t puzzle_len)
+{
+    if (len >= 4 && strncmp(line, "SAT ", 4) == 0) {
+        const char* grid = line + 4;
+        if (len - 4 < puzzle_len
+            || (len - 4 > puzzle_len && grid[puzzle_len] != ' '))
+        {
+            return ANSWER_WRONG;
+        }
+        for (size_t c = 0; c < puzzle_len; ++c) {
+            const char given = puzzle[c];
+            if (given == '.' || given == '0') {
+                if (grid[c] == '.') {
+                    return ANSWER_WRONG;
+                }
+            } else if ((given | 0x20) != (grid[c] | 0x20)) {
+                return ANSWER_WRONG;
+            }
+        }
+        return ANSWER_SAT;
+    } else if (len == 5 && strncmp(line, "UNSAT", 5) == 0) {
+        return ANSWER_UNSAT;
+    } else if (len == 7 && strncmp(line, "UNKNOWN", 7) == 0) {
+        return ANSWER_UNKNOWN;
+    }
+    return ANSWER_ERROR;
+}
+
+
+static int _write_all(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+
+static int _connect(const char* path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+
+static void* _client_main(void* arg)
+{
+    LoadClient* client = (LoadClient*)arg;
+    const LoadOptions* opts = client->opts;
+    const int depth = opts->depth;
+
+    /* puzzle and send time of the requests in flight */
+    long* sent_puzzle = (long*)malloc(depth * sizeof(long));
+    double* sent_ms = (double*)malloc(depth * sizeof(double));
+    char* out = NULL;
+    size_t out_size = 0;
+    char* in = (char*)malloc(READ_SIZE);
+    size_t in_size = READ_SIZE;
+    size_t in_len = 0;
+    int fd = _connect(opts->socket_path);
+    if (fd < 0 || sent_puzzle == NULL || sent_ms == NULL || in == NULL) {
+        client->failed = 1;
+    }
+
+    const long first = client->id * opts->n_puzzles / opts->n_clients;
+    long n_sent = 0;
+    while (!client->failed && client->n_answers < client->n_requests) {
+        /* fill the pipeline, one write for all the requests */
+        size_t out_len = 0;
+        const double now_ms = _now_ms();
+        while (n_sent < client->n_requests
+               && n_sent - client->n_answers < depth)
+        {
+            const long p = (first + n_sent) % opts->n_puzzles;
+            const size_t len = opts->lengths[p];
+            if (out_len + len + 1 > out_size) {
+                char* grown = (char*)realloc(out, 2 * (out_len + len + 1));
+                if (grown == NULL) {
+                    client->failed = 1;
+                    break;
+                }
+                out = grown;
+                out_size = 2 * (out_len + len + 1);
+            }
+            memcpy(out + out_len, opts->puzzles[p], len);
+            out[out_len + len] = '\n';
+            out_len += len + 1;
+            sent_puzzle[n_sent % depth] = p;
+            sent_ms[n_sent % depth] = now_ms;
+            n_sent += 1;
+        }
+        if (client->failed || _write_all(fd, out, out_len) != 0) {
+            client->failed = 1;
+            break;
+        }
+
+        /* then the answers that have come */
+        if (in_len == in_size) {
+            char* grown = (char*)realloc(in, 2 * in_size);
+            if (grown == NULL) {
+                client->failed = 1;
+                break;
+            }
+            in = grown;
+            in_size *= 2;
+        }
+        ssize_t n = read(fd, in + in_len, in_size - in_len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            client->failed = 1;
+            break;
+        }
+        in_len += (size_t)n;
+
+        const double now = _now_ms();
+        size_t start = 0;
+        const char* nl;
+        while ((nl = memchr(in + start, '\n', in_len - start)) != NULL
+               && client->n_answers < n_sent)
+        {
+            const long slot = client->n_answers % depth;
+            const long p = sent_puzzle[slot];
+            const size_t len = (size_t)(nl - (in + start));
+            client->counts[_classify(in + start, len, opts->puzzles[p],
+                                     opts->lengths[p])] += 1;
+            client->latencies[client->n_answers] = now - sent_ms[slot];
+            client->n_answers += 1;
+            start += len + 1;
+        }
+        memmove(in, in + start, in_len - start);
+        in_len -= start;
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(sent_puzzle);
+    free(sent_ms);
+    free(out);
+    free(in);
+    return NULL;
+}
+
+
+static int _compare_ms(const void* a, const void* b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+int main(int argc, char** argv)
+{
+    LoadOptions opts = {
+        .socket_path = NULL,
+        .n_clients = 4,
+        .depth = 16,
+        .n_requests = 0,
+        .puzzles = NULL,
+        .lengths = NULL,
+        .n_puzzles = 0,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:n:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                opts.n_clients = atoi(optarg);
+                break;
+            case 'd':
+                opts.depth = atoi(optarg);
+                break;
+            case 'n':
+                opts.n_requests = atol(optarg);
+                break;
+            default:
+                _usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind + 2 != argc || opts.n_clients <= 0 || opts.depth <= 0
+        || opts.n_requests < 0)
+    {
+        _usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    opts.socket_path = argv[optind];
+    if (_load_puzzles(argv[optind + 1], &opts) != 0 || opts.n_puzzles == 0) {
+        printf("Error: no puzzles in %s\n", argv[optind + 1]);
+        return EXIT_FAILURE;
+    }
+
+    LoadClient* clients = (LoadClient*)calloc(opts.n_clients,
+                                              sizeof(LoadClient));
+    if (clients == NULL) {
+        printf("Error: out of memory\n");
+        return EXIT_FAILURE;
+    }
+    long n_total = 0;
+    for (int c = 0; c < opts.n_clients; ++c) {
+        clients[c].opts = &opts;
+        clients[c].id = c;
+        clients[c].n_requests = opts.n_requests > 0 ? opts.n_requests
+                                                    : opts.n_puzzles;
+        clients[c].latencies = (double*)malloc(clients[c].n_requests
+                                               * sizeof(double));
+        clients[c].failed = clients[c].latencies == NULL;
+        n_total += clients[c].n_requests;
+    }
+
+    /* a server that stops fails the writes, it is reported below */
+    signal(SIGPIPE, SIG_IGN);
+
+    const double start = _now_ms();
+    int n_started = 0;
+    for (int c = 0; c < opts.n_clients; ++c) {
+        if (clients[c].failed
+            || pthread_create(&clients[c].thread, NULL, _client_main,
+                              &clients[c]) != 0)
+        {
+            clients[c].failed = 1;
+            break;
+        }
+        n_started += 1;
+    }
+    for (int c = 0; c < n_started; ++c) {
+        pthread_join(clients[c].thread, NULL);
+    }
+    const double elapsed_ms = _now_ms() - start;
+
+    /* every latency, sorted for the percentiles */
+    double* latencies = (double*)malloc((n_total > 0 ? n_total : 1)
+                                        * sizeof(double));
+    long n_answers = 0;
+    long counts[N_ANSWERS] = { 0 };
+    int n_failed = 0;
+    for (int c = 0; c < opts.n_clients; ++c) {
+        for (long a = 0; a < clients[c].n_answers && latencies != NULL;
+             ++a)
+        {
+            latencies[n_answers++] = clients[c].latencies[a];
+        }
+        for (int k = 0; k < N_ANSWERS; ++k) {
+            counts[k] += clients[c].counts[k];
+        }
+        n_failed += clients[c].failed;
+        free(clients[c].latencies);
+    }
+    free(clients);
+
+    printf("Requests: %ld of %ld answered in %.3f s, %.1f per second\n",
+           n_answers, n_total, elapsed_ms / 1e3,
+           elapsed_ms > 0 ? n_answers * 1e3 / elapsed_ms : 0.0);
+    printf("Answers:");
+    for (int k = 0; k < N_ANSWERS; ++k) {
+        printf(" %ld %s%s", counts[k], ANSWER_NAMES[k],
+               k + 1 < N_ANSWERS ? "," : "\n");
+    }
+    if (n_answers > 0) {
+        qsort(latencies, n_answers, sizeof(double), _compare_ms);
+        printf("Latency (ms): p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+               latencies[n_answers / 2], latencies[n_answers * 9 / 10],
+               latencies[n_answers * 99 / 100], latencies[n_answers - 1]);
+    }
+    if (n_failed > 0) {
+        printf("Error: %d clients lost their connection\n", n_failed);
+    }
+    free(latencies);
+    for (long p = 0; p < opts.n_puzzles; ++p) {
+        free(opts.puzzles[p]);
+    }
+    free(opts.puzzles);
+    free(opts.lengths);
+    return n_failed == 0 && counts[ANSWER_WRONG] == 0 ? EXIT_SUCCESS
+                                                      : EXIT_FAILURE;
+}
@@ -0,0 +1,388 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "canon.h"
+
+/* rounds of invariant refinement, each one looks one step further */
+#define REFINE_ROUNDS 3
+
+
+/* Invariants of the lines and values of one orientation of a grid, with
+ * room for the next round of each. */
+typedef struct
+{
+    uint64_t* row;         /* n_values entries */
+    uint64_t* col;
+    uint64_t* value;       /* n_values + 1, value 0 unused */
+    uint64_t* next_row;
+    uint64_t* next_col;
+    uint64_t* next_value;
+    uint64_t* band;        /* one per band */
+    uint64_t* stack;       /* one per stack */
+} Invariants;
+
+
+/* Line with the invariant it is sorted by. */
+typedef struct
+{
+    uint64_t key;
+    int index;
+} SortItem;
+
+
+/* Everything a canonicalization needs besides its result. */
+typedef struct
+{
+    Invariants inv;
+    SortItem* items;       /* n_values entries */
+    SudokuTransform other; /* the transposed candidate */
+    SudokuCell* cells;     /* its canonical grid */
+    uint64_t* block;       /* single allocation behind `inv` */
+} Scratch;
+
+
+/***** Private functions *****/
+
+static uint64_t _mix(uint64_t x)  /* splitmix64 finalizer */
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+
+/* Cell (i, j) of `sudoku`, or (j, i) when `transposed`. */
+static inline int _get(const Sudoku* sudoku, int transposed, int i, int j)
+{
+    return transposed ? sudoku_get(sudoku, j, i) : sudoku_get(sudoku, i, j);
+}
+
+
+static int _compare_items(const void* a, const void* b)
+{
+    const SortItem* x = (const SortItem*)a;
+    const SortItem* y = (const SortItem*)b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->index - y->index;  /* ties keep their position */
+}
+
+
+static int _scratch_init(Scratch* scratch, const Sudoku* sudoku)
+{
+    const size_t n = (size_t)sudoku->n_values;
+    memset(scratch, 0, sizeof(Scratch));
+    scratch->block = (uint64_t*)malloc((8 * n + 2) * sizeof(uint64_t));
+    scratch->items = (SortItem*)malloc(n * sizeof(SortItem));
+    scratch->cells = (SudokuCell*)malloc(n * n * sizeof(SudokuCell));
+    if (scratch->block == NULL || scratch->items == NULL
+        || scratch->cells == NULL
+        || sudoku_transform_init(&scratch->other, (int)n) != 0)
+    {
+        return -1;
+    }
+
+    Invariants* inv = &scratch->inv;
+    inv->row = scratch->block;
+    inv->col = inv->row + n;
+    inv->value = inv->col + n;
+    inv->next_row = inv->value + n + 1;
+    inv->next_col = inv->next_row + n;
+    inv->next_value = inv->next_col + n;
+    inv->band = inv->next_value + n + 1;
+    inv->stack = inv->band + n;
+    return 0;
+}
+
+
+static void _scratch_release(Scratch* scratch)
+{
+    sudoku_transform_release(&scratch->other);
+    free(scratch->block);
+    free(scratch->items);
+    free(scratch->cells);
+}
+
+
+/* Sums of the line invariants per band and per stack: the multiset of the
+ * lines they hold. */
+static void _group_invariants(const Sudoku* sudoku, Invariants* inv)
+{
+    const int n = sudoku->n_values;
+    memset(inv->band, 0, (n / sudoku->region_n_rows) * sizeof(uint64_t));
+    memset(inv->stack, 0, (n / sudoku->region_n_cols) * sizeof(uint64_t));
+    for (int i = 0; i < n; ++i) {
+        inv->band[i / sudoku->region_n_rows] += _mix(inv->row[i]);
+        inv->stack[i / sudoku->region_n_cols] += _mix(inv->col[i]);
+    }
+}
+
+
+/* Computes the invariants of rows, columns and values: their number of
+ * givens first, then REFINE_ROUNDS rounds folding in the invariants of the
+ * lines and values each one meets. Sums of mixed terms stand for multisets,
+ * so nothing depends on the order the grid is laid out in. */
+static void _refine(const Sudoku* sudoku, int transposed, Invariants* inv)
+{
+    const int n = sudoku->n_values;
+    const int R = sudoku->region_n_rows, C = sudoku->region_n_cols;
+    memset(inv->row, 0, n * sizeof(uint64_t));
+    memset(inv->col, 0, n * sizeof(uint64_t));
+    memset(inv->value, 0, (n + 1) * sizeof(uint64_t));
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const int v = _get(sudoku, transposed, i, j);
+            if (v > 0) {
+                inv->row[i] += 1;
+                inv->col[j] += 1;
+                inv->value[v] += 1;
+            }
+        }
+    }
+
+    for (int round = 0; round < REFINE_ROUNDS; ++round) {
+        _group_invariants(sudoku, inv);
+        for (int k = 0; k < n; ++k) {
+            inv->next_row[k] = _mix(inv->row[k] + _mix(inv->band[k / R]));
+            inv->next_col[k] = _mix(inv->col[k] + _mix(inv->stack[k / C]));
+        }
+        for (int v = 1; v <= n; ++v) {
+            inv->next_value[v] = _mix(inv->value[v]);
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const uint64_t row = inv->row[i] ^ _mix(inv->band[i / R] + 1);
+            for (int j = 0; j < n; ++j) {
+                const int v = _get(sudoku, transposed, i, j);
+                if (v == 0) {
+                    continue;
+                }
+                const uint64_t col = inv->col[j] ^ _mix(inv->stack[j / C] + 2);
+                inv->next_row[i] += _mix(_mix(col) + inv->value[v]);
+                inv->next_col[j] += _mix(_mix(row) + inv->value[v]);
+                inv->next_value[v] += _mix(_mix(row) + 3 * _mix(col));
+            }
+        }
+
+        uint64_t* swap = inv->row;
+        inv->row = inv->next_row;
+        inv->next_row = swap;
+        swap = inv->col;
+        inv->col = inv->next_col;
+        inv->next_col = swap;
+        swap = inv->value;
+        inv->value = inv->next_value;
+        inv->next_value = swap;
+    }
+    _group_invariants(sudoku, inv);
+}
+
+
+/* Orders the lines of one direction into `line_of`: groups (bands or
+ * stacks) of `group_size` lines by `group`, then the lines of each group
+ * by `line`. */
+static void _order_lines(int n, int group_size, const uint64_t* group,
+                         const uint64_t* line, SortItem* items, int* line_of)
+{
+    const int n_groups = n / group_size;
+    for (int g = 0; g < n_groups; ++g) {
+        items[g].key = group[g];
+        items[g].index = g;
+    }
+    qsort(items, n_groups, sizeof(SortItem), _compare_items);
+
+    /* the groups are read back from the end of `line_of`, so the lines of
+     * each group can be sorted in `items` */
+    for (int g = 0; g < n_groups; ++g) {
+        line_of[n - n_groups + g] = items[g].index;
+    }
+    for (int g = 0; g < n_groups; ++g) {
+        const int first = line_of[n - n_groups + g] * group_size;
+        for (int k = 0; k < group_size; ++k) {
+            items[k].key = line[first + k];
+            items[k].index = first + k;
+        }
+        qsort(items, group_size, sizeof(SortItem), _compare_items);
+        for (int k = 0; k < group_size; ++k) {
+            line_of[g * group_size + k] = items[k].index;
+        }
+    }
+}
+
+
+/* Canonical form of one orientation of `puzzle`, into `transform` and
+ * `cells`. */
+static void _canonicalize_view(const Sudoku* puzzle, int transposed,
+                               Scratch* scratch, SudokuTransform* transform,
+                               SudokuCell* cells)
+{
+    const int n = puzzle->n_values;
+    Invariants* inv = &scratch->inv;
+    _refine(puzzle, transposed, inv);
+
+    transform->transposed = transposed;
+    _order_lines(n, puzzle->region_n_rows, inv->band, inv->row,
+                 scratch->items, transform->row_of);
+    _order_lines(n, puzzle->region_n_cols, inv->stack, inv->col,
+                 scratch->items, transform->col_of);
+
+    /* values are named in order of appearance, unused ones last */
+    memset(transform->value_to, 0, (n + 1) * sizeof(SudokuCell));
+    int n_named = 0;
+    for (int r = 0; r < n; ++r) {
+        for (int c = 0; c < n; ++c) {
+            const int v = _get(puzzle, transposed, transform->row_of[r],
+                               transform->col_of[c]);
+            if (v > 0 && transform->value_to[v] == 0) {
+                transform->value_to[v] = (SudokuCell)++n_named;
+            }
+            cells[r * n + c] = transform->value_to[v];
+        }
+    }
+    for (int v = 1; v <= n; ++v) {
+        if (transform->value_to[v] == 0) {
+            transform->value_to[v] = (SudokuCell)++n_named;
+        }
+    }
+    transform->value_of[0] = 0;
+    for (int v = 1; v <= n; ++v) {
+        transform->value_of[transform->value_to[v]] = (SudokuCell)v;
+    }
+}
+
+
+static void _transform_copy(SudokuTransform* dst, const SudokuTransform* src)
+{
+    const int n = src->n_values;
+    dst->transposed = src->transposed;
+    memcpy(dst->row_of, src->row_of, n * sizeof(int));
+    memcpy(dst->col_of, src->col_of, n * sizeof(int));
+    memcpy(dst->value_of, src->value_of, (n + 1) * sizeof(SudokuCell));
+    memcpy(dst->value_to, src->value_to, (n + 1) * sizeof(SudokuCell));
+}
+
+
+/* FNV-1a over the shape and the cells. */
+static uint64_t _hash(const Sudoku* sudoku)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const uint64_t prime = 0x100000001b3ULL;
+    h = (h ^ (uint64_t)sudoku->region_n_rows) * prime;
+    h = (h ^ (uint64_t)sudoku->region_n_cols) * prime;
+    for (int c = 0; c < sudoku->n_cells; ++c) {
+        h = (h ^ sudoku->cells[c]) * prime;
+    }
+    return h;
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+int sudoku_transform_init(SudokuTransform* transform, int n_values)
+{
+    transform->n_values = n_values;
+    transform->transposed = 0;
+    transform->row_of = (int*)malloc(n_values * sizeof(int));
+    transform->col_of = (int*)malloc(n_values * sizeof(int));
+    transform->value_of = (SudokuCell*)malloc((n_values + 1)
+                                              * sizeof(SudokuCell));
+    transform->value_to = (SudokuCell*)malloc((n_values + 1)
+                                              * sizeof(SudokuCell));
+    if (transform->row_of == NULL || transform->col_of == NULL
+        || transform->value_of == NULL || transform->value_to == NULL)
+    {
+        sudoku_transform_release(transform);
+        return -1;
+    }
+    return 0;
+}
+
+
+void sudoku_transform_release(SudokuTransform* transform)
+{
+    free(transform->row_of);
+    free(transform->col_of);
+    free(transform->value_of);
+    free(transform->value_to);
+    transform->row_of = NULL;
+    transform->col_of = NULL;
+    transform->value_of = NULL;
+    transform->value_to = NULL;
+}
+
+
+int sudoku_canonicalize(const Sudoku* puzzle, Sudoku* canon,
+                        SudokuTransform* transform, uint64_t* hash)
+{
+    Scratch scratch;
+    if (_scratch_init(&scratch, puzzle) != 0) {
+        _scratch_release(&scratch);
+        return -1;
+    }
+
+    _canonicalize_view(puzzle, 0, &scratch, transform, canon->cells);
+
+    /* transposing keeps the shape only with square regions; the smaller
+     * of both forms is the canonical one */
+    if (puzzle->region_n_rows == puzzle->region_n_cols) {
+        _canonicalize_view(puzzle, 1, &scratch, &scratch.other,
+                           scratch.cells);
+        for (int c = 0; c < puzzle->n_cells; ++c) {
+            if (scratch.cells[c] != canon->cells[c]) {
+                if (scratch.cells[c] < canon->cells[c]) {
+                    memcpy(canon->cells, scratch.cells,
+                           puzzle->n_cells * sizeof(SudokuCell));
+                    _transform_copy(transform, &scratch.other);
+                }
+                break;
+            }
+        }
+    }
+    canon->n_fixed_cells = puzzle->n_fixed_cells;
+    *hash = _hash(canon);
+
+    _scratch_release(&scratch);
+    return 0;
+}
+
+
+void sudoku_transform_apply(const SudokuTransform* transform,
+                            const Sudoku* original, Sudoku* canon)
+{
+    const int n = transform->n_values;
+    for (int r = 0; r < n; ++r) {
+        for (int c = 0; c < n; ++c) {
+            const int v = _get(original, transform->transposed,
+                               transform->row_of[r], transform->col_of[c]);
+            sudoku_set(canon, r, c, transform->value_to[v]);
+        }
+    }
+    canon->n_fixed_cells = original->n_fixed_cells;
+}
+
+
+void sudoku_transform_revert(const SudokuTransform* transform,
+                             const Sudoku* canon, Sudoku* original)
+{
+    const int n = transform->n_values;
+    for (int r = 0; r < n; ++r) {
+        for (int c = 0; c < n; ++c) {
+            const int v = transform->value_of[sudoku_get(canon, r, c)];
+            if (transform->transposed) {
+                sudoku_set(original, transform->col_of[c],
+                           transform->row_of[r], v);
+            } else {
+                sudoku_set(original, transform->row_of[r],
+                           transform->col_of[c], v);
+            }
+        }
+    }
+    original->n_fixed_cells = canon->n_fixed_cells;
+}
@@ -0,0 +1,67 @@
+#ifndef _CANON_H_
+#define _CANON_H_
+
+#include <stdint.h>
+
+#include "sudoku.h"
+
+/**
+ * Symmetry taking a grid to its canonical form. Canonical cell (r, c) holds
+ * the canonical value of the original cell at row `row_of[r]` and column
+ * `col_of[c]`, read from the transposed grid when `transposed` is set.
+ */
+typedef struct
+{
+    int n_values;
+    int transposed;         /* only for square regions */
+    int* row_of;            /* n_values entries */
+    int* col_of;
+    SudokuCell* value_of;   /* canonical value -> original, n_values + 1 */
+    SudokuCell* value_to;   /* original value -> canonical, n_values + 1 */
+} SudokuTransform;
+
+/**
+ * Allocates a transform for grids of `n_values` values. Returns 0 on
+ * success, -1 if memory is exhausted.
+ */
+int sudoku_transform_init(SudokuTransform* transform, int n_values);
+
+/**
+ *
+ */
+void sudoku_transform_release(SudokuTransform* transform);
+
+/**
+ * Stores in `canon` (same shape as `puzzle`) the canonical form of
+ * `puzzle` under the symmetries that keep a sudoku a sudoku: relabeling
+ * of the values, permutations of the rows within a band and of the bands,
+ * of the columns within a stack and of the stacks, and transposition for
+ * square regions. `transform` receives the symmetry used and `hash` a hash
+ * of the canonical grid, shape included.
+ *
+ * Rows, columns and values are told apart by invariants refined over a
+ * few rounds (givens per line, the lines and values they meet, the bands
+ * and stacks they sit in), and sorted by them. Puzzles with lines that the
+ * invariants cannot tell apart may get different forms for equivalent
+ * puzzles, ties being broken by position: a cache keyed on the hash then
+ * misses, but the form is always a valid image of `puzzle`.
+ *
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int sudoku_canonicalize(const Sudoku* puzzle, Sudoku* canon,
+                        SudokuTransform* transform, uint64_t* hash);
+
+/**
+ * Maps `original` to canonical coordinates and values into `canon`.
+ */
+void sudoku_transform_apply(const SudokuTransform* transform,
+                            const Sudoku* original, Sudoku* canon);
+
+/**
+ * Maps `canon` back to the coordinates and values of the original grid,
+ * into `original`.
+ */
+void sudoku_transform_revert(const SudokuTransform* transform,
+                             const Sudoku* canon, Sudoku* original);
+
+#endif
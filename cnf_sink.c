@@ -0,0 +1,259 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cnf_sink.h"
+
+#define WRITER_BUF_SIZE (1 << 20)
+#define WRITER_MAX_LIT_LEN 16   /* '-', up to 10 digits, ' ' */
+
+
+/***** Buffered DIMACS writer *****/
+
+typedef struct
+{
+    int fd;
+    off_t header_offset;  /* -1 for streams, the header is final */
+    int n_vars;           /* announced by the header of a stream */
+    int64_t n_clauses;
+    int error;
+
+    size_t len;
+    char buf[WRITER_BUF_SIZE];
+} CnfWriter;
+
+
+static int _write_all(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+
+static void _writer_flush(CnfWriter* w)
+{
+    if (w->len > 0 && !w->error) {
+        w->error = _write_all(w->fd, w->buf, w->len) != 0;
+    }
+    w->len = 0;
+}
+
+
+static void _writer_add(CnfSink* sink, int lit)
+{
+    CnfWriter* w = (CnfWriter*)sink->data;
+    if (w->len + WRITER_MAX_LIT_LEN > WRITER_BUF_SIZE) {
+        _writer_flush(w);
+    }
+
+    char* p = w->buf + w->len;
+    if (lit == 0) {
+        *p++ = '0';
+        *p++ = '\n';
+    } else {
+        unsigned u = lit < 0 ? -(unsigned)lit : (unsigned)lit;
+        if (lit < 0) {
+            *p++ = '-';
+        }
+        char digits[10];
+        int n_digits = 0;
+        do {
+            digits[n_digits++] = (char)('0' + u % 10);
+            u /= 10;
+        } while (u != 0);
+        while (n_digits > 0) {
+            *p++ = digits[--n_digits];
+        }
+        *p++ = ' ';
+    }
+    w->len = (size_t)(p - w->buf);
+}
+
+
+static void _writer_comment(CnfSink* sink, const char* text)
+{
+    CnfWriter* w = (CnfWriter*)sink->data;
+    const size_t len = strlen(text);
+    if (w->len + len + 3 > WRITER_BUF_SIZE) {
+        _writer_flush(w);
+        if (len + 3 > WRITER_BUF_SIZE) {
+            return;  /* absurdly long, not worth it */
+        }
+    }
+
+    w->buf[w->len++] = 'c';
+    w->buf[w->len++] = ' ';
+    memcpy(w->buf + w->len, text, len);
+    w->len += len;
+    w->buf[w->len++] = '\n';
+}
+
+
+static void _format_header(char* header, int n_vars, int64_t n_clauses)
+{
+    int len = snprintf(header, CNF_HEADER_SIZE, "p cnf %d %" PRId64,
+                       n_vars, n_clauses);
+    memset(header + len, ' ', CNF_HEADER_SIZE - len);
+    header[CNF_HEADER_SIZE - 1] = '\n';
+}
+
+
+/***** Counting sink *****/
+
+static void _counter_add(CnfSink* sink, int lit)
+{
+    (void)sink;
+    (void)lit;
+}
+
+
+static CnfWriter* _writer_new(CnfSink* sink, int fd)
+{
+    CnfWriter* w = (CnfWriter*)malloc(sizeof(CnfWriter));
+    if (w == NULL) {
+        return NULL;
+    }
+    w->fd = fd;
+    w->header_offset = -1;
+    w->n_vars = 0;
+    w->n_clauses = 0;
+    w->error = 0;
+    w->len = 0;
+
+    sink->add = _writer_add;
+    sink->comment = _writer_comment;
+    sink->data = w;
+    sink->n_vars = 0;
+    sink->n_clauses = 0;
+    sink->amo_encoding = 0;
+    return w;
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+int cnf_sink_open_writer(CnfSink* sink, int fd)
+{
+    const off_t header_offset = lseek(fd, 0, SEEK_CUR);
+    CnfWriter* w = header_offset < 0 ? NULL : _writer_new(sink, fd);
+    if (w == NULL) {
+        return -1;
+    }
+    w->header_offset = header_offset;
+
+    /* placeholder, the real counts are only known at the end */
+    _format_header(w->buf, 0, 0);
+    w->len = CNF_HEADER_SIZE;
+    return 0;
+}
+
+
+int cnf_sink_open_stream(CnfSink* sink, int fd, int n_vars,
+                         int64_t n_clauses)
+{
+    CnfWriter* w = _writer_new(sink, fd);
+    if (w == NULL) {
+        return -1;
+    }
+    w->n_vars = n_vars;
+    w->n_clauses = n_clauses;
+
+    _format_header(w->buf, n_vars, n_clauses);
+    w->len = CNF_HEADER_SIZE;
+    return 0;
+}
+
+
+int cnf_sink_close_writer(CnfSink* sink)
+{
+    CnfWriter* w = (CnfWriter*)sink->data;
+    _writer_flush(w);
+
+    char header[CNF_HEADER_SIZE];
+    _format_header(header, sink->n_vars, sink->n_clauses);
+    int ret = w->error ? -1 : 0;
+    if (w->header_offset < 0) {  /* a stream, its header is out already */
+        if (sink->n_vars != w->n_vars || sink->n_clauses != w->n_clauses) {
+            ret = -1;
+        }
+    } else if (ret == 0
+               && pwrite(w->fd, header, CNF_HEADER_SIZE, w->header_offset)
+                  != CNF_HEADER_SIZE)
+    {
+        ret = -1;
+    }
+
+    free(w);
+    sink->data = NULL;
+    return ret;
+}
+
+
+void cnf_sink_init_counter(CnfSink* sink)
+{
+    sink->add = _counter_add;
+    sink->comment = NULL;
+    sink->data = NULL;
+    sink->n_vars = 0;
+    sink->n_clauses = 0;
+    sink->amo_encoding = 0;
+}
+
+
+void cnf_sink_reserve_vars(CnfSink* sink, int n_vars)
+{
+    if (n_vars > sink->n_vars) {
+        sink->n_vars = n_vars;
+    }
+}
+
+
+int cnf_sink_new_var(CnfSink* sink)
+{
+    return ++sink->n_vars;
+}
+
+
+void cnf_sink_add(CnfSink* sink, int lit)
+{
+    if (lit == 0) {
+        sink->n_clauses += 1;
+    } else if (abs(lit) > sink->n_vars) {
+        sink->n_vars = abs(lit);
+    }
+    sink->add(sink, lit);
+}
+
+
+void cnf_sink_clause(CnfSink* sink, const int* lits, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        cnf_sink_add(sink, lits[i]);
+    }
+    cnf_sink_add(sink, 0);
+}
+
+
+void cnf_sink_comment(CnfSink* sink, const char* text)
+{
+    if (sink->comment != NULL) {
+        sink->comment(sink, text);
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef _CNF_SINK_H_
+#define _CNF_SINK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Destination for the clauses produced by the encoder. A sink receives the
+ * formula one literal at a time, in DIMACS order: the literals of a clause
+ * followed by the terminating 0.
+ *
+ * The sink keeps track of the biggest variable it has seen and of the
+ * number of clauses it has received, regardless of where they end up.
+ * Auxiliary variables are allocated from the sink as well, so that
+ * `n_vars` always covers them.
+ */
+typedef struct CnfSink CnfSink;
+
+struct CnfSink
+{
+    void (*add)(CnfSink* sink, int lit);
+    void (*comment)(CnfSink* sink, const char* text);  /* may be NULL */
+    void* data;
+
+    int n_vars;
+    int64_t n_clauses;  /* big grids go past 2^31 clauses */
+
+    int amo_encoding;  /* AmoEncoding used by amo()/eo(), see encoder.h */
+};
+
+/* size of the 'p cnf' line written by the DIMACS writer, padded */
+#define CNF_HEADER_SIZE 48
+
+/**
+ * Initializes `sink` to write the formula in DIMACS format to the seekable
+ * file descriptor `fd`, from its current offset on. Literals are formatted
+ * by hand into a large buffer that is flushed with big write() calls. The
+ * header is written as a fixed-size placeholder and patched with the real
+ * variable and clause counts by `cnf_sink_close_writer`.
+ *
+ * Returns 0 on success, -1 on error (memory or `fd` not seekable).
+ */
+int cnf_sink_open_writer(CnfSink* sink, int fd);
+
+/**
+ * Initializes `sink` to write the formula in DIMACS format to `fd`, which
+ * does not need to be seekable: the header is written first, with counts
+ * known in advance (from a run of the encoder on a counting sink), so a
+ * reader on the other end of a pipe can parse the clauses as they come.
+ * `cnf_sink_close_writer` checks that the formula matched the counts.
+ *
+ * Returns 0 on success, -1 if memory is exhausted.
+ */
+int cnf_sink_open_stream(CnfSink* sink, int fd, int n_vars,
+                         int64_t n_clauses);
+
+/**
+ * Flushes the formula and writes the final header. `fd` is not closed.
+ * Returns 0 on success, -1 if some write failed (or a stream did not match
+ * its header).
+ */
+int cnf_sink_close_writer(CnfSink* sink);
+
+/**
+ * Initializes `sink` to discard the clauses, only counting them. Useful to
+ * size a formula before writing it.
+ */
+void cnf_sink_init_counter(CnfSink* sink);
+
+/**
+ * Makes sure variables 1..`n_vars` are never handed out as auxiliary
+ * variables.
+ */
+void cnf_sink_reserve_vars(CnfSink* sink, int n_vars);
+
+/**
+ * Allocates a fresh auxiliary variable.
+ */
+int cnf_sink_new_var(CnfSink* sink);
+
+/**
+ * Adds `lit` to the clause under construction; 0 closes the clause.
+ */
+void cnf_sink_add(CnfSink* sink, int lit);
+
+/**
+ * Adds the clause formed by the `size` literals in `lits`.
+ */
+void cnf_sink_clause(CnfSink* sink, const int* lits, int size);
+
+/**
+ * Emits a comment line. Sinks that cannot store comments ignore it.
+ */
+void cnf_sink_comment(CnfSink* sink, const char* text);
+
+#endif
@@ -0,0 +1,60 @@
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "deadline.h"
+
+static atomic_long n_fired = 0;
+
+
+/***** Public functions *****/
+
+void deadline_set(Deadline* deadline, double seconds)
+{
+    deadline->active = seconds > 0;
+    clock_gettime(CLOCK_MONOTONIC, &deadline->at);
+    if (deadline->active) {
+        const long whole = (long)seconds;
+        deadline->at.tv_sec += whole;
+        deadline->at.tv_nsec += (long)((seconds - whole) * 1e9);
+        if (deadline->at.tv_nsec >= 1000000000L) {
+            deadline->at.tv_sec += 1;
+            deadline->at.tv_nsec -= 1000000000L;
+        }
+    }
+}
+
+
+int deadline_expired(const Deadline* deadline)
+{
+    return deadline_ms_left(deadline) == 0;
+}
+
+
+int deadline_ms_left(const Deadline* deadline)
+{
+    if (deadline == NULL || !deadline->active) {
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const long long ns = (deadline->at.tv_sec - now.tv_sec) * 1000000000LL
+                         + (deadline->at.tv_nsec - now.tv_nsec);
+    if (ns <= 0) {
+        return 0;
+    }
+    const long long ms = (ns + 999999) / 1000000;
+    return ms > 1000000000LL ? 1000000000 : (int)ms;
+}
+
+
+void deadline_fired(void)
+{
+    atomic_fetch_add(&n_fired, 1);
+}
+
+
+long deadline_n_fired(void)
+{
+    return atomic_load(&n_fired);
+}
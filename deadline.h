@@ -0,0 +1,45 @@
+#ifndef _DEADLINE_H_
+#define _DEADLINE_H_
+
+#include <time.h>
+
+/**
+ * Wall-clock limit for a solve call. Every backend checks it in its own
+ * way (a timer on the external solver, an interrupt of the in-process
+ * engines, a node counter in the exact cover search) and gives up with
+ * RUN_SOLVER_UNKNOWN once it is over. A NULL deadline means no limit.
+ */
+typedef struct
+{
+    int active;          /* 0: no limit, the solve runs to completion */
+    struct timespec at;  /* CLOCK_MONOTONIC */
+} Deadline;
+
+/**
+ * Sets `deadline` `seconds` from now. A non positive value disables it.
+ */
+void deadline_set(Deadline* deadline, double seconds);
+
+/**
+ * Returns 1 if `deadline` (which may be NULL) is over, 0 otherwise.
+ */
+int deadline_expired(const Deadline* deadline);
+
+/**
+ * Returns the milliseconds left before `deadline` (which may be NULL) is
+ * over, rounded up, or -1 if there is no limit.
+ */
+int deadline_ms_left(const Deadline* deadline);
+
+/**
+ * Records that a solve gave up because its deadline was over. Called by
+ * the backends, it is safe to call from several threads.
+ */
+void deadline_fired(void);
+
+/**
+ * Returns how many solves have given up because of their deadline so far.
+ */
+long deadline_n_fired(void);
+
+#endif
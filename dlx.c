@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlx.h"
+
+#define DEADLINE_POLL 4096
+
+
+/* Toroidal doubly linked lists stored in arrays: node 0 is the root, nodes
+ * 1..n_cols are the column headers, the rest belong to candidate rows. */
+typedef struct
+{
+    int *left, *right, *up, *down;
+    int *col;    /* column header of every node */
+    int *row;    /* candidate (i * n + j) * n + k of every node */
+    int *size;   /* number of nodes in every column */
+
+    int n_cols;
+    int n_nodes;
+
+    int* stack;  /* rows selected so far */
+    int depth;
+
+    Sudoku* sudoku;
+    long limit;
+    long n_solutions;
+    SolutionReport report;  /* NULL: only the first solution is kept */
+    void* data;
+
+    const Deadline* deadline;
+    long n_calls;  /* the deadline is polled every DEADLINE_POLL calls */
+    int expired;
+} Dlx;
+
+
+static void _dlx_release(Dlx* d)
+{
+    free(d->left);
+    free(d->right);
+    free(d->up);
+    free(d->down);
+    free(d->col);
+    free(d->row);
+    free(d->size);
+    free(d->stack);
+}
+
+
+static int _dlx_alloc(Dlx* d, int n_cols, int max_nodes, int max_depth)
+{
+    d->left = (int*)malloc(max_nodes * sizeof(int));
+    d->right = (int*)malloc(max_nodes * sizeof(int));
+    d->up = (int*)malloc(max_nodes * sizeof(int));
+    d->down = (int*)malloc(max_nodes * sizeof(int));
+    d->col = (int*)malloc(max_nodes * sizeof(int));
+    d->row = (int*)malloc(max_nodes * sizeof(int));
+    d->size = (int*)calloc(n_cols + 1, sizeof(int));
+    d->stack = (int*)malloc(max_depth * sizeof(int));
+    if (d->left == NULL || d->right == NULL || d->up == NULL
+        || d->down == NULL || d->col == NULL || d->row == NULL
+        || d->size == NULL || d->stack == NULL)
+    {
+        _dlx_release(d);
+        return -1;
+    }
+
+    d->n_cols = n_cols;
+    for (int c = 0; c <= n_cols; ++c) {
+        d->left[c] = c == 0 ? n_cols : c - 1;
+        d->right[c] = c == n_cols ? 0 : c + 1;
+        d->up[c] = c;
+        d->down[c] = c;
+        d->col[c] = c;
+    }
+    d->n_nodes = n_cols + 1;
+    d->depth = 0;
+    return 0;
+}
+
+
+/* Appends a candidate row covering the 4 columns in `cols`. */
+static void _dlx_add_row(Dlx* d, int row_id, const int* cols)
+{
+    const int first = d->n_nodes;
+    for (int t = 0; t < 4; ++t) {
+        const int node = d->n_nodes++;
+        const int c = cols[t];
+        d->col[node] = c;
+        d->row[node] = row_id;
+        d->up[node] = d->up[c];
+        d->down[node] = c;
+        d->down[d->up[c]] = node;
+        d->up[c] = node;
+        d->size[c] += 1;
+        d->left[node] = t == 0 ? first + 3 : node - 1;
+        d->right[node] = t == 3 ? first : node + 1;
+    }
+}
+
+
+static void _cover(Dlx* d, int c)
+{
+    d->right[d->left[c]] = d->right[c];
+    d->left[d->right[c]] = d->left[c];
+    for (int i = d->down[c]; i != c; i = d->down[i]) {
+        for (int j = d->right[i]; j != i; j = d->right[j]) {
+            d->down[d->up[j]] = d->down[j];
+            d->up[d->down[j]] = d->up[j];
+            d->size[d->col[j]] -= 1;
+        }
+    }
+}
+
+
+static void _uncover(Dlx* d, int c)
+{
+    for (int i = d->up[c]; i != c; i = d->up[i]) {
+        for (int j = d->left[i]; j != i; j = d->left[j]) {
+            d->size[d->col[j]] += 1;
+            d->down[d->up[j]] = j;
+            d->up[d->down[j]] = j;
+        }
+    }
+    d->right[d->left[c]] = c;
+    d->left[d->right[c]] = c;
+}
+
+
+static void _record_solution(Dlx* d)
+{
+    const int n = d->sudoku->n_values;
+    for (int s = 0; s < d->depth; ++s) {
+        const int cand = d->row[d->stack[s]];
+        d->sudoku->cells[cand / n] = cand % n + 1;
+    }
+}
+
+
+static void _search(Dlx* d)
+{
+    if (++d->n_calls % DEADLINE_POLL == 0 && deadline_expired(d->deadline)) {
+        d->expired = 1;
+    }
+    if (d->expired) {
+        return;
+    }
+
+    if (d->right[0] == 0) {
+        if (d->n_solutions == 0 || d->report != NULL) {
+            _record_solution(d);
+        }
+        d->n_solutions += 1;
+        if (d->report != NULL
+            && d->report(d->sudoku, d->n_solutions, d->data) != 0)
+        {
+            d->limit = d->n_solutions;  /* stops the search */
+        }
+        return;
+    }
+
+    /* column with fewest candidates first */
+    int c = d->right[0];
+    for (int j = d->right[c]; j != 0; j = d->right[j]) {
+        if (d->size[j] < d->size[c]) {
+            c = j;
+        }
+    }
+    if (d->size[c] == 0) {
+        return;
+    }
+
+    _cover(d, c);
+    for (int r = d->down[c];
+         r != c && d->n_solutions < d->limit && !d->expired; r = d->down[r])
+    {
+        d->stack[d->depth++] = r;
+        for (int j = d->right[r]; j != r; j = d->right[j]) {
+            _cover(d, d->col[j]);
+        }
+        _search(d);
+        for (int j = d->left[r]; j != r; j = d->left[j]) {
+            _uncover(d, d->col[j]);
+        }
+        d->depth -= 1;
+    }
+    _uncover(d, c);
+}
+
+
+static RunSolverCode _dlx_run(Sudoku* sudoku, long limit, long* n_solutions,
+                              SolutionReport report, void* data,
+                              const Deadline* deadline)
+{
+    const int n = sudoku->n_values;
+    const int l = sudoku->region_n_rows;
+    const int m = sudoku->region_n_cols;
+    const int n2 = n * n;
+
+    /* candidate rows: only the fixed value for fixed cells */
+    int n_rows = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            n_rows += sudoku_get(sudoku, i, j) > 0 ? 1 : n;
+        }
+    }
+
+    Dlx d;
+    if (_dlx_alloc(&d, 4 * n2, 4 * n2 + 1 + 4 * n_rows, n2) != 0) {
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+    d.sudoku = sudoku;
+    d.limit = limit > 1 ? limit : 1;
+    d.n_solutions = 0;
+    d.report = report;
+    d.data = data;
+    d.deadline = deadline;
+    d.n_calls = 0;
+    d.expired = 0;
+
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const int r = (i / l) * (n / m) + j / m;
+            for (int k = 0; k < n; ++k) {
+                const int given = sudoku_get(sudoku, i, j);
+                if (given > 0 && given != k + 1) {
+                    continue;
+                }
+                const int cols[4] = {
+                    1 + i * n + j,            /* cell */
+                    1 + n2 + i * n + k,       /* value in row */
+                    1 + 2 * n2 + j * n + k,   /* value in column */
+                    1 + 3 * n2 + r * n + k,   /* value in region */
+                };
+                _dlx_add_row(&d, (i * n + j) * n + k, cols);
+            }
+        }
+    }
+
+    /* select the fixed cells up front; a clash means there is no solution */
+    int consistent = 1;
+    for (int node = 4 * n2 + 1; node < d.n_nodes && consistent; node += 4) {
+        const int cand = d.row[node];
+        if (sudoku->cells[cand / n] == 0) {
+            continue;
+        }
+        for (int t = 0; t < 4; ++t) {
+            const int c = d.col[node + t];
+            /* a covered column is no longer linked from its neighbours */
+            if (d.right[d.left[c]] != c) {
+                consistent = 0;
+                break;
+            }
+        }
+        if (consistent) {
+            d.stack[d.depth++] = node;
+            for (int t = 0; t < 4; ++t) {
+                _cover(&d, d.col[node + t]);
+            }
+        }
+    }
+
+    if (consistent) {
+        _search(&d);
+    }
+
+    if (n_solutions != NULL) {
+        *n_solutions = d.n_solutions;
+    }
+    _dlx_release(&d);
+    if (d.expired) {
+        deadline_fired();
+    }
+    if (d.n_solutions > 0) {
+        return RUN_SOLVER_SAT;
+    }
+    return d.expired ? RUN_SOLVER_UNKNOWN : RUN_SOLVER_UNSAT;
+}
+
+
+RunSolverCode dlx_solve(Sudoku* sudoku, long limit, long* n_solutions,
+                        const Deadline* deadline)
+{
+    return _dlx_run(sudoku, limit, n_solutions, NULL, NULL, deadline);
+}
+
+
+RunSolverCode dlx_enumerate(const Sudoku* puzzle, long limit,
+                            long* n_solutions, SolutionReport report,
+                            void* data, const Deadline* deadline)
+{
+    /* each solution is written over the same copy of the puzzle */
+    Sudoku* grid = sudoku_clone(puzzle);
+    if (grid == NULL) {
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+    RunSolverCode code = _dlx_run(grid, limit, n_solutions, report, data,
+                                  deadline);
+    sudoku_delete(grid);
+    return code;
+}
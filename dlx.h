@@ -0,0 +1,37 @@
+#ifndef _DLX_H_
+#define _DLX_H_
+
+#include "run_solver.h"
+#include "sudoku.h"
+#include "unique.h"
+
+/**
+ * Solves `sudoku` as an exact cover problem (one column per cell, per value
+ * in a row, per value in a column and per value in a region) with Knuth's
+ * dancing links, no CNF involved.
+ *
+ * The search goes on until `limit` solutions have been found (or the space
+ * is exhausted), a `limit` <= 1 stops at the first one. If `n_solutions` is
+ * not NULL it receives the number of solutions found. The first solution is
+ * stored in the cells of `sudoku`.
+ *
+ * If `deadline` is not NULL the search stops once it is over; solutions
+ * found until then are kept (the count is then a lower bound).
+ *
+ * Returns RUN_SOLVER_SAT if there is at least one solution,
+ * RUN_SOLVER_UNSAT if there is none, RUN_SOLVER_UNKNOWN if the deadline
+ * was over before finding one, or RUN_SOLVER_ERR_MEMORY.
+ */
+RunSolverCode dlx_solve(Sudoku* sudoku, long limit, long* n_solutions,
+                        const Deadline* deadline);
+
+/**
+ * Same search as dlx_solve, passing every solution found to `report` (if
+ * not NULL) instead of keeping the first one; `puzzle` is left as it is.
+ * Returning non zero from `report` stops the search.
+ */
+RunSolverCode dlx_enumerate(const Sudoku* puzzle, long limit,
+                            long* n_solutions, SolutionReport report,
+                            void* data, const Deadline* deadline);
+
+#endif
@@ -0,0 +1,529 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "encoder.h"
+
+/* below this size every encoding falls back to the pairwise one */
+#define AMO_PAIRWISE_MAX 6
+
+static const char* AMO_ENCODING_NAMES[] = {
+    "pairwise", "sequential", "commander", "product", "bimander"
+};
+
+
+int x(const Sudoku* s, int i, int j, int k)
+{
+    const int n = s->n_values;
+    return i * n * n + j * n + k + 1;
+}
+
+
+/***** At-most-one encodings *****/
+
+static void _binary(CnfSink* sink, int a, int b)
+{
+    cnf_sink_add(sink, a);
+    cnf_sink_add(sink, b);
+    cnf_sink_add(sink, 0);
+}
+
+
+static void _amo_pairwise(CnfSink* sink, const int *vars, int size)
+{
+    for (int i = 0; i < size - 1; ++i) {
+        for (int j = i + 1; j < size; ++j) {
+            _binary(sink, -vars[i], -vars[j]);
+        }
+    }
+}
+
+
+/* Sinz's sequential counter: s_i holds iff some of x_1..x_i is true */
+static void _amo_sequential(CnfSink* sink, const int *vars, int size)
+{
+    int prev = cnf_sink_new_var(sink);
+    _binary(sink, -vars[0], prev);
+    for (int i = 1; i < size - 1; ++i) {
+        int s = cnf_sink_new_var(sink);
+        _binary(sink, -vars[i], s);
+        _binary(sink, -prev, s);
+        _binary(sink, -vars[i], -prev);
+        prev = s;
+    }
+    _binary(sink, -vars[size - 1], -prev);
+}
+
+
+/* Klieber & Kwon: groups of 3 with a commander each, recursively */
+static int _amo_commander(CnfSink* sink, const int *vars, int size)
+{
+    const int group_size = 3;
+    const int n_groups = (size + group_size - 1) / group_size;
+    int* commanders = (int*)malloc(n_groups * sizeof(int));
+    if (commanders == NULL) {
+        return -1;
+    }
+
+    for (int g = 0; g < n_groups; ++g) {
+        const int begin = g * group_size;
+        const int end = begin + group_size < size ? begin + group_size : size;
+        commanders[g] = cnf_sink_new_var(sink);
+        _amo_pairwise(sink, vars + begin, end - begin);
+        for (int i = begin; i < end; ++i) {
+            _binary(sink, -vars[i], commanders[g]);
+        }
+    }
+
+    amo(sink, commanders, n_groups);
+    free(commanders);
+    return 0;
+}
+
+
+/* Chen's 2-product: x_k sits at (k / q, k % q) of a p x q grid */
+static int _amo_product(CnfSink* sink, const int *vars, int size)
+{
+    int p = 1;
+    while (p * p < size) {
+        p += 1;
+    }
+    const int q = (size + p - 1) / p;
+
+    int* aux = (int*)malloc((p + q) * sizeof(int));
+    if (aux == NULL) {
+        return -1;
+    }
+    int* rows = aux;
+    int* cols = aux + p;
+    for (int i = 0; i < p + q; ++i) {
+        aux[i] = cnf_sink_new_var(sink);
+    }
+
+    for (int k = 0; k < size; ++k) {
+        _binary(sink, -vars[k], rows[k / q]);
+        _binary(sink, -vars[k], cols[k % q]);
+    }
+
+    amo(sink, rows, (size + q - 1) / q);
+    amo(sink, cols, q);
+    free(aux);
+    return 0;
+}
+
+
+/* Nguyen & Mai: pairs with pairwise AMO, group index in binary */
+static void _amo_bimander(CnfSink* sink, const int *vars, int size)
+{
+    const int group_size = 2;
+    const int n_groups = (size + group_size - 1) / group_size;
+    int n_bits = 0;
+    while ((1 << n_bits) < n_groups) {
+        n_bits += 1;
+    }
+
+    const int first_bit = sink->n_vars + 1;
+    for (int b = 0; b < n_bits; ++b) {
+        cnf_sink_new_var(sink);
+    }
+
+    for (int i = 0; i < size; ++i) {
+        const int g = i / group_size;
+        if (i % group_size == 0) {
+            const int end = i + group_size < size ? i + group_size : size;
+            _amo_pairwise(sink, vars + i, end - i);
+        }
+        for (int b = 0; b < n_bits; ++b) {
+            const int bit = first_bit + b;
+            _binary(sink, -vars[i], (g >> b) & 1 ? bit : -bit);
+        }
+    }
+}
+
+
+/****************************/
+
+
+AmoEncoding amo_encoding_from_name(const char* name)
+{
+    const int n_names = sizeof(AMO_ENCODING_NAMES) / sizeof(char*);
+    for (int i = 0; i < n_names; ++i) {
+        if (strcmp(name, AMO_ENCODING_NAMES[i]) == 0) {
+            return (AmoEncoding)i;
+        }
+    }
+    return AMO_INVALID;
+}
+
+
+const char* amo_encoding_name(AmoEncoding encoding)
+{
+    return AMO_ENCODING_NAMES[encoding];
+}
+
+
+void alo(CnfSink* sink, int *vars, int size)
+{
+    cnf_sink_clause(sink, vars, size);
+}
+
+void amo(CnfSink* sink, int *vars, int size)
+{
+    if (size <= AMO_PAIRWISE_MAX) {
+        _amo_pairwise(sink, vars, size);
+        return;
+    }
+
+    int ret = 0;
+    switch ((AmoEncoding)sink->amo_encoding) {
+        case AMO_SEQUENTIAL:
+            _amo_sequential(sink, vars, size);
+            break;
+        case AMO_COMMANDER:
+            ret = _amo_commander(sink, vars, size);
+            break;
+        case AMO_PRODUCT:
+            ret = _amo_product(sink, vars, size);
+            break;
+        case AMO_BIMANDER:
+            _amo_bimander(sink, vars, size);
+            break;
+        default:
+            _amo_pairwise(sink, vars, size);
+    }
+
+    if (ret != 0) {  /* out of memory for the auxiliary arrays */
+        _amo_pairwise(sink, vars, size);
+    }
+}
+
+void eo(CnfSink* sink, int *vars, int size)
+{
+    alo(sink, vars, size);
+    amo(sink, vars, size);
+}
+
+
+int sudoku_encode_num_vars(const Sudoku* sudoku)
+{
+    const long long n = sudoku->n_values;
+    return n * n * n <= INT_MAX ? (int)(n * n * n) : -1;
+}
+
+
+int sudoku_encode_rules(CnfSink* sink, const Sudoku* sudoku)
+{
+    const int n = sudoku->n_values;
+    const int l = sudoku->region_n_rows;
+    const int m = sudoku->region_n_cols;
+
+    int* vars = (int*)malloc(n * sizeof(int));
+    if (vars == NULL || sudoku_encode_num_vars(sudoku) < 0) {
+        free(vars);
+        return -1;
+    }
+
+    /* cell variables come first, auxiliary ones are allocated after them */
+    cnf_sink_reserve_vars(sink, sudoku_encode_num_vars(sudoku));
+
+    /* only one value per cell */
+    cnf_sink_comment(sink, "Cell constraints");
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            for (int k = 0; k < n; ++k) {
+                vars[k] = x(sudoku, i, j, k);
+            }
+            eo(sink, vars, n);
+        }
+    }
+
+    /* every value exactly once per row */
+    cnf_sink_comment(sink, "Row constraints");
+    for (int i = 0; i < n; ++i) {
+        for (int k = 0; k < n; ++k) {
+            for (int j = 0; j < n; ++j) {
+                vars[j] = x(sudoku, i, j, k);
+            }
+            eo(sink, vars, n);
+        }
+    }
+
+    /* every value exactly once per column */
+    cnf_sink_comment(sink, "Column constraints");
+    for (int j = 0; j < n; ++j) {
+        for (int k = 0; k < n; ++k) {
+            for (int i = 0; i < n; ++i) {
+                vars[i] = x(sudoku, i, j, k);
+            }
+            eo(sink, vars, n);
+        }
+    }
+
+    /* every value exactly once per region (l rows by m columns) */
+    cnf_sink_comment(sink, "Region constraints");
+    for (int r0 = 0; r0 < n; r0 += l) {
+        for (int c0 = 0; c0 < n; c0 += m) {
+            for (int k = 0; k < n; ++k) {
+                int size = 0;
+                for (int i = r0; i < r0 + l; ++i) {
+                    for (int j = c0; j < c0 + m; ++j) {
+                        vars[size++] = x(sudoku, i, j, k);
+                    }
+                }
+                eo(sink, vars, size);
+            }
+        }
+    }
+
+    free(vars);
+    return 0;
+}
+
+
+int sudoku_given_literals(const Sudoku* sudoku, int* lits)
+{
+    const int n = sudoku->n_values;
+    int n_lits = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const int value = sudoku_get(sudoku, i, j);
+            if (value > 0) {
+                lits[n_lits++] = x(sudoku, i, j, value - 1);
+            }
+        }
+    }
+    return n_lits;
+}
+
+
+int sudoku_encode(CnfSink* sink, const Sudoku* sudoku)
+{
+    if (sudoku_encode_rules(sink, sudoku) != 0) {
+        return -1;
+    }
+
+    cnf_sink_comment(sink, "Fixed number constraints");
+    const int n = sudoku->n_values;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const int value = sudoku_get(sudoku, i, j);
+            if (value > 0) {
+                cnf_sink_add(sink, x(sudoku, i, j, value - 1));
+                cnf_sink_add(sink, 0);
+            }
+        }
+    }
+    return 0;
+}
+
+
+void sudoku_decode_model(Sudoku* sudoku, const int* model)
+{
+    const int n = sudoku->n_values;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            for (int k = 0; k < n; ++k) {
+                if (model[x(sudoku, i, j, k) - 1] > 0) {
+                    sudoku_set(sudoku, i, j, k + 1);
+                }
+            }
+        }
+    }
+}
+
+
+/***** Pruned encoding *****/
+
+/* Stores in `cells` the n cells (i * n + j) of unit `u`: rows come first,
+ * then columns and then regions. */
+static void _unit_cells(const Sudoku* sudoku, int u, int* cells)
+{
+    const int n = sudoku->n_values;
+    const int l = sudoku->region_n_rows;
+    const int m = sudoku->region_n_cols;
+
+    if (u < n) {
+        for (int j = 0; j < n; ++j) {
+            cells[j] = u * n + j;
+        }
+    } else if (u < 2 * n) {
+        for (int i = 0; i < n; ++i) {
+            cells[i] = i * n + (u - n);
+        }
+    } else {
+        const int r = u - 2 * n;
+        const int r0 = (r / (n / m)) * l;
+        const int c0 = (r % (n / m)) * m;
+        for (int c = 0; c < n; ++c) {
+            cells[c] = (r0 + c / m) * n + c0 + c % m;
+        }
+    }
+}
+
+
+/* Returns 1 if value k + 1 is still possible in the empty cell (i, j). */
+static int _is_candidate(const Sudoku* sudoku, const char* placed, int i,
+                         int j, int k)
+{
+    const size_t n = sudoku->n_values;
+    return !placed[i * n + k] && !placed[(n + j) * n + k]
+        && !placed[(2 * n + sudoku_region(sudoku, i, j)) * n + k];
+}
+
+
+int sudoku_encode_pruned(CnfSink* sink, const Sudoku* sudoku, VarMap* map)
+{
+    const int n = sudoku->n_values;
+    const int n_units = 3 * n;
+
+    map->n_vars = 0;
+    map->first = (int*)malloc((sudoku->n_cells + 1) * sizeof(int));
+    map->value_of = NULL;
+    char* placed = (char*)calloc((size_t)n_units * n, sizeof(char));
+    int* cells = (int*)malloc(n * sizeof(int));
+    int* vars = (int*)malloc(n * sizeof(int));
+    if (map->first == NULL || placed == NULL || cells == NULL
+        || vars == NULL)
+    {
+        free(placed);
+        free(cells);
+        free(vars);
+        var_map_release(map);
+        return -1;
+    }
+
+    /* values placed by the fixed cells in every row, column and region */
+    int conflict = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const int k = sudoku_get(sudoku, i, j) - 1;
+            if (k < 0) {
+                continue;
+            }
+            const int units[3] = { i, n + j,
+                                   2 * n + sudoku_region(sudoku, i, j) };
+            for (int u = 0; u < 3; ++u) {
+                conflict |= placed[(size_t)units[u] * n + k];
+                placed[(size_t)units[u] * n + k] = 1;
+            }
+        }
+    }
+
+    /* the map is sized from the candidates left, never from n^3 */
+    long long n_vars = 0;
+    for (int c = 0; c < sudoku->n_cells; ++c) {
+        for (int k = 0; k < n && sudoku->cells[c] == 0; ++k) {
+            n_vars += _is_candidate(sudoku, placed, c / n, c % n, k);
+        }
+    }
+    if (n_vars < INT_MAX) {
+        map->value_of = (SudokuCell*)malloc((n_vars + 1)
+                                            * sizeof(SudokuCell));
+    }
+    if (map->value_of == NULL) {
+        free(placed);
+        free(cells);
+        free(vars);
+        var_map_release(map);
+        return -1;
+    }
+
+    /* a variable for every candidate, cell after cell */
+    for (int c = 0; c < sudoku->n_cells; ++c) {
+        map->first[c] = map->n_vars + 1;
+        for (int k = 0; k < n && sudoku->cells[c] == 0; ++k) {
+            if (_is_candidate(sudoku, placed, c / n, c % n, k)) {
+                map->value_of[++map->n_vars] = (SudokuCell)k;
+            }
+        }
+    }
+    map->first[sudoku->n_cells] = map->n_vars + 1;
+    cnf_sink_reserve_vars(sink, map->n_vars);
+
+    if (conflict) {
+        cnf_sink_comment(sink, "Contradicting fixed cells");
+        cnf_sink_add(sink, 0);
+    }
+
+    cnf_sink_comment(sink, "Cell constraints");
+    for (int c = 0; c < sudoku->n_cells; ++c) {
+        if (sudoku->cells[c] > 0) {
+            continue;
+        }
+        int size = 0;
+        for (int v = map->first[c]; v < map->first[c + 1]; ++v) {
+            vars[size++] = v;
+        }
+        eo(sink, vars, size);
+    }
+
+    cnf_sink_comment(sink, "Row, column and region constraints");
+    for (int u = 0; u < n_units; ++u) {
+        _unit_cells(sudoku, u, cells);
+        for (int k = 0; k < n; ++k) {
+            if (placed[(size_t)u * n + k]) {
+                continue;
+            }
+            int size = 0;
+            for (int c = 0; c < n; ++c) {
+                const int var = var_map_var(map, sudoku, cells[c] / n,
+                                            cells[c] % n, k);
+                if (var != 0) {
+                    vars[size++] = var;
+                }
+            }
+            eo(sink, vars, size);
+        }
+    }
+
+    free(placed);
+    free(cells);
+    free(vars);
+    return 0;
+}
+
+
+int var_map_var(const VarMap* map, const Sudoku* sudoku, int i, int j,
+                int k)
+{
+    if (map->first == NULL) {
+        return x(sudoku, i, j, k);
+    }
+
+    /* the values of a cell are sorted */
+    const int c = i * sudoku->n_cols + j;
+    int lo = map->first[c], hi = map->first[c + 1];
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (map->value_of[mid] < k) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < map->first[c + 1] && map->value_of[lo] == k ? lo : 0;
+}
+
+
+void var_map_release(VarMap* map)
+{
+    free(map->first);
+    free(map->value_of);
+    map->first = NULL;
+    map->value_of = NULL;
+    map->n_vars = 0;
+}
+
+
+void sudoku_decode_pruned(Sudoku* sudoku, const VarMap* map,
+                          const int* model)
+{
+    for (int c = 0; c < sudoku->n_cells; ++c) {
+        for (int v = map->first[c]; v < map->first[c + 1]; ++v) {
+            if (model[v - 1] > 0) {
+                sudoku->cells[c] = map->value_of[v] + 1;
+            }
+        }
+    }
+}
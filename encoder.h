@@ -0,0 +1,136 @@
+#ifndef _ENCODER_H_
+#define _ENCODER_H_
+
+#include "cnf_sink.h"
+#include "sudoku.h"
+
+/**
+ * Encodings available for the at-most-one constraints emitted by amo() and
+ * eo(). The encoding in use is the `amo_encoding` of the sink.
+ *
+ *  - pairwise:   one binary clause per pair, no auxiliary variables
+ *  - sequential: sequential counter (ladder), n - 1 auxiliary variables
+ *  - commander:  groups of 3 with a commander variable, recursively
+ *  - product:    2-product, sqrt(n) row and column variables, recursively
+ *  - bimander:   pairs plus the pair index in binary, log2(n) variables
+ *
+ * Constraints over a handful of variables always use the pairwise one.
+ */
+typedef enum {
+    AMO_INVALID = -1,
+    AMO_PAIRWISE = 0,
+    AMO_SEQUENTIAL,
+    AMO_COMMANDER,
+    AMO_PRODUCT,
+    AMO_BIMANDER,
+} AmoEncoding;
+
+/**
+ * Looks up an encoding by name, returns AMO_INVALID if there is none.
+ */
+AmoEncoding amo_encoding_from_name(const char* name);
+
+/**
+ *
+ */
+const char* amo_encoding_name(AmoEncoding encoding);
+
+/**
+ * Variable that is true iff cell (i, j) holds value k + 1, in the full
+ * layout of n^3 cell variables.
+ */
+int x(const Sudoku* s, int i, int j, int k);
+
+/**
+ * At-least-one, at-most-one and exactly-one constraints over `vars`.
+ */
+void alo(CnfSink* sink, int *vars, int size);
+void amo(CnfSink* sink, int *vars, int size);
+void eo(CnfSink* sink, int *vars, int size);
+
+/**
+ * Number of cell variables of `sudoku`. They are numbered 1..n^3, auxiliary
+ * variables introduced by the AMO encodings come after them; the total is
+ * found in the sink once the formula is encoded.
+ *
+ * Returns -1 if n^3 does not fit in a DIMACS variable, such grids can only
+ * be encoded with sudoku_encode_pruned.
+ */
+int sudoku_encode_num_vars(const Sudoku* sudoku);
+
+/**
+ * Encodes the cell, row, column and region constraints of `sudoku`
+ * together with its fixed cells into `sink`.
+ *
+ * Returns 0 on success, or -1 if memory could not be allocated.
+ */
+int sudoku_encode(CnfSink* sink, const Sudoku* sudoku);
+
+/**
+ * Encodes only the cell, row, column and region constraints, which depend
+ * on the shape of `sudoku` and not on its fixed cells. The result can be
+ * shared by every puzzle of the same shape.
+ *
+ * Returns 0 on success, or -1 if memory could not be allocated.
+ */
+int sudoku_encode_rules(CnfSink* sink, const Sudoku* sudoku);
+
+/**
+ * Stores in `lits` the literal of every fixed cell of `sudoku`, ready to be
+ * used as unit clauses or assumptions. `lits` must have room for
+ * `sudoku->n_cells` literals. Returns the number of literals stored.
+ */
+int sudoku_given_literals(const Sudoku* sudoku, int* lits);
+
+/**
+ * Variables of a pruned encoding. Only the candidates that survive the
+ * fixed cells get a variable, numbered 1..n_vars cell after cell and by
+ * increasing value within a cell. The map takes memory for the cells and
+ * the variables only, never for the n^3 layout, so it scales to grids
+ * where that layout would not fit.
+ *
+ * With `first` NULL the map describes the full x(i, j, k) layout.
+ */
+typedef struct
+{
+    int n_vars;
+    int* first;             /* cell -> its first variable, n_cells + 1 */
+    SudokuCell* value_of;   /* variable -> its value - 1, n_vars + 1 */
+} VarMap;
+
+/**
+ * Returns the variable of value k + 1 in cell (i, j), 0 if it was pruned.
+ */
+int var_map_var(const VarMap* map, const Sudoku* sudoku, int i, int j,
+                int k);
+
+/**
+ * Encodes `sudoku` applying its fixed cells while encoding: fixed cells and
+ * values already placed in a row, column or region get no variables,
+ * satisfied constraints are dropped and falsified literals are left out.
+ * Contradicting fixed cells produce the empty clause. `map` receives the
+ * variable mapping, to be released with `var_map_release`.
+ *
+ * Returns 0 on success, or -1 if memory could not be allocated.
+ */
+int sudoku_encode_pruned(CnfSink* sink, const Sudoku* sudoku, VarMap* map);
+
+/**
+ *
+ */
+void var_map_release(VarMap* map);
+
+/**
+ * Fills the empty cells of `sudoku` from the `model` of a pruned encoding,
+ * where model[v - 1] holds the value of variable v.
+ */
+void sudoku_decode_pruned(Sudoku* sudoku, const VarMap* map,
+                          const int* model);
+
+/**
+ * Fills the cells of `sudoku` from `model`, where model[v - 1] holds the
+ * value of variable v as a signed literal.
+ */
+void sudoku_decode_model(Sudoku* sudoku, const int* model);
+
+#endif
@@ -0,0 +1,294 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "generator.h"
+
+
+typedef struct Generator Generator;
+
+typedef struct
+{
+    pthread_t thread;
+    Generator* gen;
+    BatchPool pool;  /* solver of this thread only */
+} GeneratorWorker;
+
+
+/* State of the puzzle being minimized, guarded by `mutex`. */
+struct Generator
+{
+    Sudoku* solution;
+    Sudoku* puzzle;   /* givens left so far */
+    int* order;       /* cells in the order they are tried */
+    int next;         /* next entry of `order` to try */
+    int n_testing;    /* cells being tested right now */
+    long version;     /* removals accepted so far */
+    long round;       /* puzzles started */
+    int closing;
+    int failed;       /* a solver call failed */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;  /* a puzzle started or closing */
+    pthread_cond_t done_cond;  /* every cell has been tried */
+};
+
+
+/***** Private functions *****/
+
+/* Returns 1 if `value` may go in cell (i, j) of a partial grid. */
+static int _fits(const Sudoku* s, int i, int j, int value)
+{
+    const int region = sudoku_region(s, i, j);
+    for (int r = 0; r < s->n_values; ++r) {
+        for (int c = 0; c < s->n_values; ++c) {
+            if ((r == i || c == j || sudoku_region(s, r, c) == region)
+                && sudoku_get(s, r, c) == value)
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+
+/* Fills `grid` with a random full grid: a few random values, then the
+ * solver completes them. */
+static int _fill_grid(Sudoku* grid, BatchPool* pool, unsigned* seed)
+{
+    BatchSolver* solver = batch_pool_get(pool, grid);
+    if (solver == NULL) {
+        return -1;
+    }
+
+    const int n = grid->n_values;
+    for (;;) {
+        sudoku_reset(grid);
+        for (int k = 0; k < n; ++k) {
+            const int c = rand_r(seed) % grid->n_cells;
+            const int i = c / grid->n_cols, j = c % grid->n_cols;
+            const int value = 1 + rand_r(seed) % n;
+            if (sudoku_get(grid, i, j) == 0 && _fits(grid, i, j, value)) {
+                sudoku_set(grid, i, j, value);
+            }
+        }
+
+        switch (batch_solve(solver, grid, NULL)) {
+            case RUN_SOLVER_SAT:
+                return 0;
+            case RUN_SOLVER_UNSAT:  /* the random values clash, try again */
+                break;
+            default:
+                return -1;
+        }
+    }
+}
+
+
+/* Stores in `lits` the givens left with the value of `cell` negated, so a
+ * model is a solution that differs in that cell. Returns their number. */
+static int _removal_literals(const Generator* gen, int cell, int* lits)
+{
+    const Sudoku* s = gen->solution;
+    const int i = cell / s->n_cols, j = cell % s->n_cols;
+    const int lit = x(s, i, j, sudoku_get(s, i, j) - 1);
+
+    const int n_lits = sudoku_given_literals(gen->puzzle, lits);
+    for (int l = 0; l < n_lits; ++l) {
+        if (lits[l] == lit) {
+            lits[l] = -lit;
+        }
+    }
+    return n_lits;
+}
+
+
+/* Tries cells of the current puzzle until there are none left. */
+static void _minimize(Generator* gen, BatchPool* pool)
+{
+    BatchSolver* solver = batch_pool_get(pool, gen->solution);
+
+    pthread_mutex_lock(&gen->mutex);
+    while (gen->next < gen->puzzle->n_cells) {
+        const int cell = gen->order[gen->next++];
+        gen->n_testing += 1;
+
+        for (;;) {
+            const long version = gen->version;
+            RunSolverCode code = RUN_SOLVER_ERR_MEMORY;
+            if (solver != NULL) {
+                const int n_lits = _removal_literals(gen, cell, solver->lits);
+                pthread_mutex_unlock(&gen->mutex);
+                for (int l = 0; l < n_lits; ++l) {
+                    inc_solver_assume(&solver->solver, solver->lits[l]);
+                }
+                code = inc_solver_solve(&solver->solver, NULL, 0, NULL);
+                pthread_mutex_lock(&gen->mutex);
+            }
+
+            if (code == RUN_SOLVER_SAT) {  /* another solution: it stays */
+                break;
+            } else if (code != RUN_SOLVER_UNSAT) {
+                gen->failed = 1;
+                break;
+            } else if (version == gen->version) {
+                gen->puzzle->cells[cell] = 0;
+                gen->version += 1;
+                break;
+            }
+            /* fewer givens than tested with, test again */
+        }
+        gen->n_testing -= 1;
+    }
+    if (gen->n_testing == 0) {
+        pthread_cond_broadcast(&gen->done_cond);
+    }
+    pthread_mutex_unlock(&gen->mutex);
+}
+
+
+static void* _worker_main(void* arg)
+{
+    GeneratorWorker* worker = (GeneratorWorker*)arg;
+    Generator* gen = worker->gen;
+
+    long seen = 0;
+    pthread_mutex_lock(&gen->mutex);
+    for (;;) {
+        while (gen->round == seen && !gen->closing) {
+            pthread_cond_wait(&gen->work_cond, &gen->mutex);
+        }
+        if (gen->closing) {
+            break;
+        }
+        seen = gen->round;
+        pthread_mutex_unlock(&gen->mutex);
+        _minimize(gen, &worker->pool);
+        pthread_mutex_lock(&gen->mutex);
+    }
+    pthread_mutex_unlock(&gen->mutex);
+    return NULL;
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+int generate_puzzles(const GeneratorConfig* config, int n_puzzles,
+                     GeneratorReport report, void* data)
+{
+    Generator gen;
+    memset(&gen, 0, sizeof(Generator));
+    pthread_mutex_init(&gen.mutex, NULL);
+    pthread_cond_init(&gen.work_cond, NULL);
+    pthread_cond_init(&gen.done_cond, NULL);
+
+    gen.solution = sudoku_new();
+    gen.puzzle = sudoku_new();
+    int ret = gen.solution == NULL || gen.puzzle == NULL ? -1 : 0;
+    if (ret == 0
+        && (sudoku_init(gen.solution, config->region_n_rows,
+                        config->region_n_cols) != NO_ERROR
+            || sudoku_init(gen.puzzle, config->region_n_rows,
+                           config->region_n_cols) != NO_ERROR))
+    {
+        ret = -1;
+    }
+    if (ret == 0) {
+        gen.order = (int*)malloc(gen.puzzle->n_cells * sizeof(int));
+        ret = gen.order == NULL ? -1 : 0;
+    }
+
+    BatchPool pool;  /* of the calling thread */
+    batch_pool_init(&pool, config->kind, config->amo_encoding);
+
+    const int n_workers = config->n_threads - 1;
+    GeneratorWorker* workers = NULL;
+    if (n_workers > 0 && ret == 0) {
+        workers = (GeneratorWorker*)calloc(n_workers,
+                                           sizeof(GeneratorWorker));
+        ret = workers == NULL ? -1 : 0;
+    }
+    int n_started = 0;
+    for (int w = 0; w < n_workers && ret == 0; ++w) {
+        workers[w].gen = &gen;
+        batch_pool_init(&workers[w].pool, config->kind,
+                        config->amo_encoding);
+        if (pthread_create(&workers[w].thread, NULL, _worker_main,
+                           &workers[w]) != 0)
+        {
+            ret = -1;
+            break;
+        }
+        n_started += 1;
+    }
+
+    unsigned seed = config->seed;
+    for (int p = 0; p < n_puzzles && ret == 0; ++p) {
+        if (_fill_grid(gen.solution, &pool, &seed) != 0) {
+            ret = -1;
+            break;
+        }
+
+        pthread_mutex_lock(&gen.mutex);
+        sudoku_copy_cells(gen.puzzle, gen.solution);
+        const int n_cells = gen.puzzle->n_cells;
+        for (int c = 0; c < n_cells; ++c) {
+            gen.order[c] = c;
+        }
+        for (int c = n_cells - 1; c > 0; --c) {  /* Fisher-Yates */
+            const int r = rand_r(&seed) % (c + 1);
+            const int tmp = gen.order[c];
+            gen.order[c] = gen.order[r];
+            gen.order[r] = tmp;
+        }
+        gen.next = 0;
+        gen.version = 0;
+        gen.round += 1;
+        pthread_cond_broadcast(&gen.work_cond);
+        pthread_mutex_unlock(&gen.mutex);
+
+        _minimize(&gen, &pool);
+
+        pthread_mutex_lock(&gen.mutex);
+        while (gen.next < n_cells || gen.n_testing > 0) {
+            pthread_cond_wait(&gen.done_cond, &gen.mutex);
+        }
+        ret = gen.failed ? -1 : 0;
+        pthread_mutex_unlock(&gen.mutex);
+
+        if (ret == 0) {
+            gen.puzzle->n_fixed_cells = n_cells - (int)gen.version;
+            report(gen.puzzle, data);
+        }
+    }
+
+    pthread_mutex_lock(&gen.mutex);
+    gen.closing = 1;
+    pthread_cond_broadcast(&gen.work_cond);
+    pthread_mutex_unlock(&gen.mutex);
+    for (int w = 0; w < n_started; ++w) {
+        pthread_join(workers[w].thread, NULL);
+    }
+    for (int w = 0; w < n_started; ++w) {
+        batch_pool_release(&workers[w].pool);
+    }
+    batch_pool_release(&pool);
+
+    free(workers);
+    free(gen.order);
+    if (gen.puzzle != NULL) {
+        sudoku_delete(gen.puzzle);
+    }
+    if (gen.solution != NULL) {
+        sudoku_delete(gen.solution);
+    }
+    pthread_cond_destroy(&gen.work_cond);
+    pthread_cond_destroy(&gen.done_cond);
+    pthread_mutex_destroy(&gen.mutex);
+    return ret;
+}
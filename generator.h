@@ -0,0 +1,45 @@
+#ifndef _GENERATOR_H_
+#define _GENERATOR_H_
+
+#include "encoder.h"
+#include "inc_solver.h"
+#include "sudoku.h"
+
+/**
+ * What the generator builds and with which solvers.
+ */
+typedef struct
+{
+    int region_n_rows;         /* shape of the puzzles */
+    int region_n_cols;
+    IncSolverKind kind;        /* solver of the per-thread BatchPool */
+    AmoEncoding amo_encoding;
+    int n_threads;             /* 1 works in the calling thread only */
+    unsigned seed;             /* same seed and one thread: same puzzles */
+} GeneratorConfig;
+
+typedef void (*GeneratorReport)(const Sudoku* puzzle, void* data);
+
+/**
+ * Generates `n_puzzles` minimal puzzles: each has a single solution, and
+ * removing any of its givens would give it more than one.
+ *
+ * A random full grid is solved first, then its cells are tried in random
+ * order for removal. A cell can go if the remaining givens, with the
+ * cell's value forbidden, are UNSAT. Every test is a solve call under
+ * assumptions on the base encoding of the shape (see batch.h), so each
+ * thread keeps a single solver and its learnt clauses across tests and
+ * puzzles. A cell that has to stay would have to stay with fewer givens
+ * too, so one pass over the cells gives a minimal puzzle.
+ *
+ * With several threads the cells of a puzzle are tested concurrently. A
+ * removal is only accepted if no other one was accepted while it was being
+ * tested, otherwise it is tested again against the current givens.
+ *
+ * `report` is called from the calling thread with each puzzle. Returns 0
+ * on success, -1 if memory, threads or a solver call failed.
+ */
+int generate_puzzles(const GeneratorConfig* config, int n_puzzles,
+                     GeneratorReport report, void* data);
+
+#endif
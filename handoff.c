@@ -0,0 +1,88 @@
+#define _GNU_SOURCE  /* memfd_create, pipe2 */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "handoff.h"
+
+/* used when there is no memfd */
+#define HANDOFF_DEFAULT_FILE "instance.cnf"
+
+
+int handoff_open(Handoff* handoff, const char* path)
+{
+    handoff->fd = -1;
+    handoff->read_fd = -1;
+    if (path == NULL) {
+#ifdef MFD_CLOEXEC
+        /* no MFD_CLOEXEC: the solver must inherit the descriptor */
+        handoff->fd = memfd_create("instance.cnf", 0);
+#else
+        errno = ENOSYS;
+#endif
+        if (handoff->fd >= 0) {
+            handoff->kind = HANDOFF_MEMFD;
+            snprintf(handoff->path, sizeof(handoff->path), "/proc/self/fd/%d",
+                     handoff->fd);
+            return 0;
+        } else if (errno != ENOSYS) {
+            return -1;
+        }
+        path = HANDOFF_DEFAULT_FILE;
+    }
+
+    handoff->kind = HANDOFF_FILE;
+    snprintf(handoff->path, sizeof(handoff->path), "%s", path);
+    handoff->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    return handoff->fd >= 0 ? 0 : -1;
+}
+
+
+int handoff_open_pipe(Handoff* handoff)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return -1;
+    }
+    /* the solver inherits the reading end only, or it would never see EOF */
+    fcntl(fds[0], F_SETFD, 0);
+
+    handoff->kind = HANDOFF_PIPE;
+    handoff->fd = fds[1];
+    handoff->read_fd = fds[0];
+    snprintf(handoff->path, sizeof(handoff->path), "/proc/self/fd/%d",
+             handoff->read_fd);
+    return 0;
+}
+
+
+void handoff_end_write(Handoff* handoff)
+{
+    if (handoff->fd >= 0) {
+        close(handoff->fd);
+        handoff->fd = -1;
+    }
+}
+
+
+void handoff_drain(Handoff* handoff)
+{
+    char buf[4096];
+    ssize_t n = 1;
+    while (handoff->read_fd >= 0 && (n > 0 || (n < 0 && errno == EINTR))) {
+        n = read(handoff->read_fd, buf, sizeof(buf));
+    }
+}
+
+
+void handoff_close(Handoff* handoff)
+{
+    if (handoff->read_fd >= 0) {
+        close(handoff->read_fd);
+        handoff->read_fd = -1;
+    }
+    handoff_end_write(handoff);
+}
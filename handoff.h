@@ -0,0 +1,65 @@
+#ifndef _HANDOFF_H_
+#define _HANDOFF_H_
+
+#include <limits.h>
+
+typedef enum {
+    HANDOFF_MEMFD,  /* anonymous memory file, never on disk */
+    HANDOFF_FILE,   /* regular file at a given path */
+    HANDOFF_PIPE,   /* read by the solver while it is being written */
+} HandoffKind;
+
+/**
+ * Where the CNF instance is written for an external solver, and the path
+ * the solver is given to read it.
+ *
+ * A memfd lives in memory only and has no name in any directory: the
+ * solver opens it through /proc/self/fd/N, N being the descriptor it
+ * inherits, so concurrent runs never share a file. A pipe is opened the
+ * same way, but only one solver can read it.
+ */
+typedef struct
+{
+    HandoffKind kind;
+    int fd;               /* for the DIMACS writer, seekable but pipes */
+    int read_fd;          /* solver end of a pipe, -1 otherwise */
+    char path[PATH_MAX];  /* for the solver */
+} Handoff;
+
+/**
+ * Creates the instance: a memfd if `path` is NULL, the file at `path`
+ * (truncated) otherwise. A memfd falls back to the file "instance.cnf"
+ * where the system has none.
+ *
+ * Returns 0 on success, -1 on error (errno is set).
+ */
+int handoff_open(Handoff* handoff, const char* path);
+
+/**
+ * Creates a pipe for cnf_sink_open_stream(): the solver reads its end as
+ * /proc/self/fd/N and parses the clauses while they are written.
+ *
+ * Returns 0 on success, -1 on error (errno is set).
+ */
+int handoff_open_pipe(Handoff* handoff);
+
+/**
+ * Closes the writing end of a pipe, the solver reads the end of the
+ * instance. To be called by the writer, which may be another thread.
+ */
+void handoff_end_write(Handoff* handoff);
+
+/**
+ * Reads and drops what is left in a pipe until its writer is done, for
+ * when the solver stopped reading (or left a child holding the pipe open)
+ * and the writer would block forever.
+ */
+void handoff_drain(Handoff* handoff);
+
+/**
+ * Releases the instance. A memfd is freed with its last descriptor, a file
+ * is left in place.
+ */
+void handoff_close(Handoff* handoff);
+
+#endif
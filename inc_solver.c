@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "inc_solver.h"
+#include "run_glucose.h"
+#include "run_picosat.h"
+
+
+int inc_solver_init(IncSolver* solver, IncSolverKind kind)
+{
+    solver->kind = kind;
+    solver->ps = NULL;
+    solver->gs = NULL;
+
+    switch (kind) {
+        case INC_SOLVER_PICOSAT:
+            solver->ps = picosat_init();
+            if (solver->ps == NULL) {
+                return -1;
+            }
+            run_picosat_sink(&solver->sink, solver->ps);
+            break;
+        case INC_SOLVER_GLUCOSE:
+            solver->gs = glucose_init();
+            if (solver->gs == NULL) {
+                return -1;
+            }
+            run_glucose_sink(&solver->sink, solver->gs);
+            break;
+    }
+    return 0;
+}
+
+
+void inc_solver_release(IncSolver* solver)
+{
+    if (solver->ps != NULL) {
+        picosat_reset(solver->ps);
+        solver->ps = NULL;
+    }
+    if (solver->gs != NULL) {
+        glucose_release(solver->gs);
+        solver->gs = NULL;
+    }
+}
+
+
+void inc_solver_assume(IncSolver* solver, int lit)
+{
+    switch (solver->kind) {
+        case INC_SOLVER_PICOSAT:
+            picosat_assume(solver->ps, lit);
+            break;
+        case INC_SOLVER_GLUCOSE:
+            glucose_assume(solver->gs, lit);
+            break;
+    }
+}
+
+
+void inc_solver_freeze(IncSolver* solver, int var)
+{
+    if (solver->kind == INC_SOLVER_GLUCOSE) {
+        glucose_freeze(solver->gs, var);
+    }
+}
+
+
+int inc_solver_new_guard(IncSolver* solver)
+{
+    return cnf_sink_new_var(&solver->sink);
+}
+
+
+void inc_solver_add_guarded(IncSolver* solver, int guard, const int* lits,
+                            int n_lits)
+{
+    cnf_sink_add(&solver->sink, -guard);
+    for (int i = 0; i < n_lits; ++i) {
+        cnf_sink_add(&solver->sink, lits[i]);
+    }
+    cnf_sink_add(&solver->sink, 0);
+}
+
+
+void inc_solver_retire_guard(IncSolver* solver, int guard)
+{
+    cnf_sink_add(&solver->sink, -guard);
+    cnf_sink_add(&solver->sink, 0);
+}
+
+
+RunSolverCode inc_solver_solve(IncSolver* solver, int* model, int n_vars,
+                               const Deadline* deadline)
+{
+    switch (solver->kind) {
+        case INC_SOLVER_PICOSAT:
+            return run_picosat(solver->ps, model, n_vars, deadline);
+        case INC_SOLVER_GLUCOSE:
+            return run_glucose(solver->gs, model, n_vars, deadline);
+    }
+    return RUN_SOLVER_UNKNOWN;
+}
@@ -0,0 +1,77 @@
+#ifndef _INC_SOLVER_H_
+#define _INC_SOLVER_H_
+
+#include "cnf_sink.h"
+#include "glucose_c.h"
+#include "picosat.h"
+#include "run_solver.h"
+
+typedef enum {
+    INC_SOLVER_PICOSAT,
+    INC_SOLVER_GLUCOSE,
+} IncSolverKind;
+
+/**
+ * In-process solver that is kept alive across several solve calls. Clauses
+ * are added through `sink` and stay in the solver (together with whatever
+ * it learns), while assumptions only last for the next solve call.
+ */
+typedef struct
+{
+    IncSolverKind kind;
+    PicoSAT* ps;
+    GlucoseSolver* gs;
+    CnfSink sink;
+} IncSolver;
+
+/**
+ * Creates the underlying solver. Returns 0 on success, -1 if memory could
+ * not be allocated.
+ */
+int inc_solver_init(IncSolver* solver, IncSolverKind kind);
+
+/**
+ * Destroys the underlying solver.
+ */
+void inc_solver_release(IncSolver* solver);
+
+/**
+ * Assumes `lit` for the next call to `inc_solver_solve`.
+ */
+void inc_solver_assume(IncSolver* solver, int lit);
+
+/**
+ * Declares that `var` will be assumed or used in clauses after the first
+ * solve call, so it must survive preprocessing.
+ */
+void inc_solver_freeze(IncSolver* solver, int var);
+
+/**
+ * Returns a fresh activation literal for temporary clauses. Clauses added
+ * with inc_solver_add_guarded only take part in the solve calls that
+ * assume the guard, until inc_solver_retire_guard disables them for good.
+ */
+int inc_solver_new_guard(IncSolver* solver);
+
+/**
+ * Adds the clause made of the `n_lits` literals of `lits`, in effect only
+ * while `guard` is assumed. Must be called before assuming anything for
+ * the next solve call.
+ */
+void inc_solver_add_guarded(IncSolver* solver, int guard, const int* lits,
+                            int n_lits);
+
+/**
+ * Permanently disables the clauses of `guard`, the solver is free to drop
+ * them.
+ */
+void inc_solver_retire_guard(IncSolver* solver, int guard);
+
+/**
+ * Solves the clauses added so far under the current assumptions. The model
+ * and `deadline` are handled as in `run_picosat`.
+ */
+RunSolverCode inc_solver_solve(IncSolver* solver, int* model, int n_vars,
+                               const Deadline* deadline);
+
+#endif
@@ -1,55 +1,547 @@
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "backend.h"
+#include "batch_driver.h"
+#include "encoder.h"
+#include "generator.h"
+#include "presolve.h"
 #include "run_solver.h"
+#include "server.h"
+#include "solution_cache.h"
 #include "sudoku.h"
-#include "teacher.h"
+#include "unique.h"
 
 
-int x(Sudoku* s, int i, int j, int k) {
-    const int n = s->n_values;
-    return i * n * n + j * n + k + 1;
+/* server limits: requests in flight per client, clients at once */
+#define DEFAULT_MAX_PENDING 64
+#define DEFAULT_MAX_CLIENTS 64
+
+
+static void _usage(const char* prog)
+{
+    printf("Usage: %s [-a <amo>] [-b <backend>] [-c <command>] [-i <file>]\n"
+           "          [-S] [-n <limit>] [-t <seconds>] [-p] [-P] [-u] "
+           "<sudoku_file>\n"
+           "       %s -B [-a <amo>] [-b <backend>] [-t <seconds>] "
+           "[-j <threads>] [-P] [-u]\n"
+           "          [-K <entries>] [-C <cache_file>] <sudoku_file>...\n"
+           "       %s -D <socket>|- [-a <amo>] [-b <backend>] [-t <seconds>] "
+           "[-j <threads>]\n"
+           "          [-P] [-u] [-K <entries>] [-C <cache_file>] "
+           "[-Q <requests>]\n"
+           "          [-W <rows>x<cols>]\n"
+           "       %s -G <rows>x<cols> [-a <amo>] [-b <backend>] [-n <count>] "
+           "[-j <threads>]\n"
+           "          [-s <seed>] [<output_file>]\n"
+           "  -a  at-most-one encoding: pairwise (default), sequential, "
+           "commander,\n"
+           "      product or bimander\n"
+           "  -b  solver backend: picosat (default, linked in-process), "
+           "glucose,\n"
+           "      external, dlx (native exact cover) or auto (the fastest "
+           "for the\n"
+           "      grid size)\n"
+           "  -c  solver command for the external backend "
+           "(default: ./picosat);\n"
+           "      repeat it to race several solvers, the first answer wins\n"
+           "  -i  write the CNF for the external backend to <file> (default: "
+           "an\n"
+           "      in-memory file passed as /proc/self/fd/N)\n"
+           "  -S  stream the CNF to the external solver through a pipe, "
+           "so it parses\n"
+           "      while the grid is encoded (a single -c)\n"
+           "  -n  count solutions up to <limit> (not with the external "
+           "backend)\n"
+           "  -t  give up on a puzzle (UNKNOWN) after <seconds>\n"
+           "  -p  prune the encoding with the fixed cells\n"
+           "  -P  fill the cells that follow from naked/hidden singles "
+           "before SAT\n"
+           "  -u  check that the solution is unique, re-solving with the "
+           "solution\n"
+           "      blocked (not with the external backend)\n"
+           "  -B  batch mode: solve every puzzle of every file (.sdk blocks "
+           "or one\n"
+           "      puzzle per line), reusing one incremental solver per "
+           "shape\n"
+           "  -j  batch mode worker threads (default: 1)\n"
+           "  -K  batch mode: answer puzzles equivalent to solved ones (up "
+           "to symmetry)\n"
+           "      from a cache of the last <entries> grids\n"
+           "  -C  batch mode: keep the cache in <cache_file> across runs "
+           "too\n"
+           "  -D  serve one-line puzzles on the UNIX socket <socket> until "
+           "SIGTERM, or\n"
+           "      on stdin/stdout with -, one answer line per puzzle, with "
+           "the solvers\n"
+           "      of -j workers kept warm (batch options apply)\n"
+           "  -Q  server: requests of a client solved at once, pipelined "
+           "(default: %d)\n"
+           "  -W  server: build the encoding of <rows>x<cols> regions at "
+           "start-up\n"
+           "  -G  generate <count> (default: 1) minimal puzzles with regions "
+           "of\n"
+           "      <rows>x<cols>, as .sdk blocks on stdout or <output_file>\n"
+           "  -s  seed of the generator (default: the current time)\n",
+           prog, prog, prog, prog, DEFAULT_MAX_PENDING);
+}
+
+
+#define MAX_COMMANDS 16
+
+/* grids in memory when only a cache file is given */
+#define DEFAULT_CACHE_SIZE 4096
+
+/* from 7x7 regions on the n^3 layout and pairwise AMOs get out of hand */
+#define LARGE_GRID_VALUES 49
+
+
+typedef struct {
+    const Backend* backend;    /* NULL: the fastest for the grid size */
+    const char* commands[MAX_COMMANDS];  /* external solvers, raced */
+    int n_commands;
+    const char* instance_file;  /* CNF for them, NULL: a memfd */
+    int stream;                /* pipe the CNF to the solver as it is built */
+    AmoEncoding amo_encoding;
+    int prune;                 /* apply the fixed cells while encoding */
+    int presolve;              /* run the logic presolver before SAT */
+    long count_limit;          /* count solutions up to this many, 0: off */
+    double timeout;            /* seconds per puzzle, 0: no deadline */
+    int n_threads;             /* batch mode workers */
+    int check_unique;          /* look for a second solution */
+    unsigned seed;             /* of the puzzle generator */
+    int cache_size;            /* solved grids kept in memory, 0: no cache */
+    const char* cache_file;    /* and on disk, NULL: none */
+    int max_pending;           /* server: pipelined requests per client */
+    const char* warm_shape;    /* server: "<rows>x<cols>" to build, or NULL */
+} Options;
+
+
+static int _print_solution(const Sudoku* solution, long index, void* data)
+{
+    (void)data;
+    printf("Solution %ld:\n", index);
+    sudoku_print(stdout, solution);
+    return 0;
+}
+
+
+typedef struct {
+    int check_unique;
+    int n_puzzles, n_sat, n_unsat, n_failed, n_presolved, n_multiple;
+} BatchStats;
+
+
+static void _report_batch_result(const BatchResult* r, void* data)
+{
+    BatchStats* stats = (BatchStats*)data;
+
+    if (r->line == 0) {  /* the file itself could not be read */
+        printf("%s: Error: %s\n", r->file,
+               sudoku_translate_error_code(r->error_code));
+        stats->n_failed += 1;
+        return;
+    }
+
+    stats->n_puzzles += 1;
+    if (r->error_code != NO_ERROR) {
+        printf("%s:%ld: Error: %s\n", r->file, r->line,
+               sudoku_translate_error_code(r->error_code));
+        stats->n_failed += 1;
+        return;
+    }
+
+    if (strcmp(r->stage, "presolve") == 0) {
+        stats->n_presolved += 1;
+    }
+    switch (r->code) {
+        case RUN_SOLVER_SAT:
+            if (stats->check_unique) {
+                printf("%s:%ld: SAT [%s] %s\n", r->file, r->line, r->stage,
+                       uniqueness_name(r->uniqueness));
+                stats->n_multiple += r->uniqueness == UNIQUENESS_MULTIPLE;
+            } else {
+                printf("%s:%ld: SAT [%s]\n", r->file, r->line, r->stage);
+            }
+            sudoku_print(stdout, r->sudoku);
+            stats->n_sat += 1;
+            break;
+        case RUN_SOLVER_UNSAT:
+            printf("%s:%ld: UNSAT [%s]\n", r->file, r->line, r->stage);
+            stats->n_unsat += 1;
+            break;
+        case RUN_SOLVER_UNKNOWN:
+            printf("%s:%ld: UNKNOWN [%s]\n", r->file, r->line, r->stage);
+            stats->n_failed += 1;
+            break;
+        default:
+            printf("%s:%ld: solver failed (code %d)\n", r->file, r->line,
+                   r->code);
+            stats->n_failed += 1;
+    }
 }
 
 
-void alo(FILE* f, int *vars, int size) {
-    /* YOUR CODE HERE */
-    int i;
-    for(int i = 0; i<size; i++){
-        fprintf(f, "%d ", vars[i]);
+/* Fills `config` from `opts` for batch and server mode, opening `cache`
+ * when one is asked for. Prints why and returns -1 if they cannot run. */
+static int _batch_config(const Options* opts, BatchConfig* config,
+                         SolutionCache* cache)
+{
+    if (opts->backend != NULL
+        && !(opts->backend->caps & BACKEND_IN_PROCESS))
+    {
+        printf("Error: batch mode needs an in-process backend\n");
+        return -1;
+    }
+    if (opts->prune) {
+        printf("Error: batch mode shares one encoding per shape, "
+               "it cannot be pruned\n");
+        return -1;
+    }
+
+    *config = (BatchConfig){
+        .backend = opts->backend,
+        .amo_encoding = opts->amo_encoding,
+        .presolve = opts->presolve,
+        .timeout = opts->timeout,
+        .n_threads = opts->n_threads,
+        .check_unique = opts->check_unique,
+        .cache = NULL,
+    };
+
+    if (opts->cache_size > 0 || opts->cache_file != NULL) {
+        const int size = opts->cache_size > 0 ? opts->cache_size
+                                              : DEFAULT_CACHE_SIZE;
+        if (solution_cache_open(cache, size, opts->cache_file) != 0) {
+            printf("Error: cannot open the cache %s: %s\n",
+                   opts->cache_file != NULL ? opts->cache_file : "",
+                   strerror(errno));
+            return -1;
+        }
+        config->cache = cache;
     }
-    fprintf(f, "0\n");
+    return 0;
 }
 
-void amo(FILE* f, int *vars, int size) {
-    /* YOUR CODE HERE */
-    for(int i=0; i<size-1; i++){
-        for(int j=i+1; j<size; j++){
-            fprintf(f, "-%d -%d 0\n", vars[i], vars[j]);
+
+static int _run_batch(const Options* opts, int n_files, char** files)
+{
+    BatchConfig config;
+    SolutionCache cache;
+    if (_batch_config(opts, &config, &cache) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    BatchStats stats = { opts->check_unique, 0, 0, 0, 0, 0, 0 };
+    int ret = batch_run(&config, n_files, files, _report_batch_result,
+                        &stats);
+    if (config.cache != NULL) {
+        if (ret == 0) {
+            printf("Cache: %ld hits, %ld misses\n", cache.n_hits,
+                   cache.n_misses);
         }
+        solution_cache_close(&cache);
+    }
+    if (ret != 0) {
+        printf("Error: could not set up the batch workers\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Batch: %d puzzles, %d SAT, %d UNSAT, %d failed, "
+           "%d finished by the presolver, %ld deadlines fired\n",
+           stats.n_puzzles, stats.n_sat, stats.n_unsat, stats.n_failed,
+           stats.n_presolved, deadline_n_fired());
+    if (opts->check_unique) {
+        printf("Uniqueness: %d of the SAT puzzles have multiple "
+               "solutions\n", stats.n_multiple);
+    }
+    return stats.n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* Parses a "<rows>x<cols>" region shape. Returns 0, or -1 after printing
+ * why. */
+static int _parse_shape(const char* shape, int* region_n_rows,
+                        int* region_n_cols)
+{
+    char tail;
+    if (sscanf(shape, "%dx%d%c", region_n_rows, region_n_cols,
+               &tail) != 2
+        || *region_n_rows <= 0 || *region_n_cols <= 0)
+    {
+        printf("Error: the shape must look like 3x3\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+static int _run_server(const Options* opts, const char* socket_path)
+{
+    ServerConfig config = {
+        .max_clients = DEFAULT_MAX_CLIENTS,
+        .max_pending = opts->max_pending,
+        .warm_region_n_rows = 0,
+        .warm_region_n_cols = 0,
+    };
+    if (opts->warm_shape != NULL
+        && _parse_shape(opts->warm_shape, &config.warm_region_n_rows,
+                        &config.warm_region_n_cols) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    SolutionCache cache;
+    if (_batch_config(opts, &config.batch, &cache) != 0) {
+        return EXIT_FAILURE;
     }
+
+    /* with -, stdout carries the answers: the rest goes to stderr */
+    ServerStats stats;
+    int ret = server_run(&config, strcmp(socket_path, "-") == 0
+                                  ? NULL : socket_path, &stats);
+    if (ret != 0) {
+        fprintf(stderr, "Error: the server failed: %s\n", strerror(errno));
+    }
+    fprintf(stderr, "Server: %ld clients, %ld requests, %ld SAT, "
+            "%ld UNSAT, %ld UNKNOWN, %ld errors\n", stats.n_clients,
+            stats.n_requests, stats.n_sat, stats.n_unsat, stats.n_unknown,
+            stats.n_errors);
+    if (config.batch.cache != NULL) {
+        fprintf(stderr, "Cache: %ld hits, %ld misses\n", cache.n_hits,
+                cache.n_misses);
+        solution_cache_close(&cache);
+    }
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static void _write_generated(const Sudoku* puzzle, void* data)
+{
+    FILE* outf = (FILE*)data;
+    sudoku_write(outf, puzzle);
+    fflush(outf);
+    fprintf(stderr, "Generated a puzzle with %d givens\n",
+            puzzle->n_fixed_cells);
 }
 
 
-void eo(FILE* f, int *vars, int size){
-    /* YOUR CODE HERE */
-    alo(f, vars, size);
-    amo(f, vars, size);
+static int _run_generator(const Options* opts, const char* shape,
+                          const char* path)
+{
+    int region_n_rows, region_n_cols;
+    if (_parse_shape(shape, &region_n_rows, &region_n_cols) != 0) {
+        return EXIT_FAILURE;
+    }
+    const Backend* backend = opts->backend != NULL
+        ? opts->backend
+        : backend_pick(region_n_rows * region_n_cols,
+                       BACKEND_CAN_INCREMENTAL | BACKEND_CAN_ASSUME);
+    if ((backend->caps & (BACKEND_CAN_INCREMENTAL | BACKEND_CAN_ASSUME))
+        != (BACKEND_CAN_INCREMENTAL | BACKEND_CAN_ASSUME))
+    {
+        printf("Error: the generator needs an incremental backend "
+               "(picosat or glucose)\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE* outf = path == NULL ? stdout : fopen(path, "w");
+    if (outf == NULL) {
+        printf("Error: %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    GeneratorConfig config = {
+        .region_n_rows = region_n_rows,
+        .region_n_cols = region_n_cols,
+        .kind = backend->kind,
+        .amo_encoding = opts->amo_encoding,
+        .n_threads = opts->n_threads,
+        .seed = opts->seed,
+    };
+    const int n_puzzles = opts->count_limit > 0 ? (int)opts->count_limit : 1;
+    int ret = generate_puzzles(&config, n_puzzles, _write_generated, outf);
+    if (ret != 0) {
+        fprintf(stderr, "Error: the generator failed\n");
+    }
+    if (outf != stdout && fclose(outf) != 0) {
+        ret = -1;
+    }
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 
 int main(int argc, char** argv)
 {
-    if (argc < 2) {
-        printf("Usage: %s <sudoku_file>\n", argv[0]);
+    Options opts = {
+        .backend = backend_find("picosat"),
+        .commands = { "./picosat" },
+        .n_commands = 0,  /* the default until a -c is given */
+        .instance_file = NULL,
+        .stream = 0,
+        .amo_encoding = AMO_PAIRWISE,
+        .prune = 0,
+        .presolve = 0,
+        .count_limit = 0,
+        .timeout = 0,
+        .n_threads = 1,
+        .check_unique = 0,
+        .seed = (unsigned)time(NULL),
+        .cache_size = 0,
+        .cache_file = NULL,
+        .max_pending = DEFAULT_MAX_PENDING,
+        .warm_shape = NULL,
+    };
+    int batch = 0;
+    int amo_given = 0;
+    const char* generate = NULL;  /* shape of the puzzles to generate */
+    const char* serve = NULL;     /* socket of the server, - for stdin */
+
+    int opt;
+    while ((opt = getopt(argc, argv,
+                         "a:b:c:i:n:t:j:s:G:K:C:D:Q:W:pPSBuh")) != -1)
+    {
+        switch (opt) {
+            case 'a':
+                opts.amo_encoding = amo_encoding_from_name(optarg);
+                amo_given = 1;
+                if (opts.amo_encoding == AMO_INVALID) {
+                    printf("Error: unknown AMO encoding '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'b':
+                opts.backend = backend_find(optarg);
+                if (opts.backend == NULL && strcmp(optarg, "auto") != 0) {
+                    printf("Error: unknown backend '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c':
+                if (opts.n_commands == MAX_COMMANDS) {
+                    printf("Error: at most %d solver commands\n",
+                           MAX_COMMANDS);
+                    return EXIT_FAILURE;
+                }
+                opts.commands[opts.n_commands++] = optarg;
+                break;
+            case 'i':
+                opts.instance_file = optarg;
+                break;
+            case 'n':
+                opts.count_limit = atol(optarg);
+                if (opts.count_limit <= 0) {
+                    printf("Error: the solution limit must be positive\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 't':
+                opts.timeout = atof(optarg);
+                if (opts.timeout <= 0) {
+                    printf("Error: the timeout must be positive\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'j':
+                opts.n_threads = atoi(optarg);
+                if (opts.n_threads <= 0) {
+                    printf("Error: the number of threads must be "
+                           "positive\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                opts.seed = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 'G':
+                generate = optarg;
+                break;
+            case 'K':
+                opts.cache_size = atoi(optarg);
+                if (opts.cache_size <= 0) {
+                    printf("Error: the cache size must be positive\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'C':
+                opts.cache_file = optarg;
+                break;
+            case 'D':
+                serve = optarg;
+                break;
+            case 'Q':
+                opts.max_pending = atoi(optarg);
+                if (opts.max_pending <= 0) {
+                    printf("Error: the pipelined requests must be "
+                           "positive\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'W':
+                opts.warm_shape = optarg;
+                break;
+            case 'p':
+                opts.prune = 1;
+                break;
+            case 'P':
+                opts.presolve = 1;
+                break;
+            case 'S':
+                opts.stream = 1;
+                break;
+            case 'B':
+                batch = 1;
+                break;
+            case 'u':
+                opts.check_unique = 1;
+                break;
+            default:
+                _usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (opts.n_commands == 0) {
+        opts.n_commands = 1;
+    }
+    if (generate != NULL) {
+        return _run_generator(&opts, generate,
+                              optind < argc ? argv[optind] : NULL);
+    }
+    if (serve != NULL) {
+        return _run_server(&opts, serve);
+    }
+    if (optind >= argc) {
+        _usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.stream && (opts.n_commands > 1 || opts.instance_file != NULL)) {
+        printf("Error: a streamed instance is read by a single solver "
+               "(one -c, no -i)\n");
         return EXIT_FAILURE;
     }
 
+    if ((opts.check_unique || opts.count_limit > 0) && opts.backend != NULL
+        && !(opts.backend->caps & BACKEND_CAN_ENUMERATE))
+    {
+        printf("Error: %s needs an in-process backend\n",
+               opts.check_unique ? "the uniqueness check"
+                                 : "solution counting");
+        return EXIT_FAILURE;
+    }
+
+    if (batch) {
+        return _run_batch(&opts, argc - optind, argv + optind);
+    }
+
     /* creating and loading the sudoku */
     Sudoku* sudoku = sudoku_new();
 
-    int error_code = sudoku_parse_file(argv[1], sudoku);
+    int error_code = sudoku_parse_file(argv[optind], sudoku);
     if (error_code == 0) {
         printf("Loaded sudoku\n");
         sudoku_print(stdout, sudoku);
@@ -58,119 +550,144 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    /* create your formula here. */
-    const int n = sudoku->n_values;
-    const int n_fixed = sudoku->n_fixed_cells;
-    int num_vars = n * n * n;                        /* ADJUST AS NECESSARY */
-    int num_clauses = n * n * (1 + (n * (n-1) / 2)); /* ADJUST AS NECESSARY */
-
-    FILE* f = fopen("instance.cnf","w");      /* file to save the instance */
-    fprintf(f, "p cnf %d %d\n", num_vars, num_clauses); /* instance header */
-
-    int* vars = (int*) malloc(n * sizeof(int));
-
-    /* only one value per cell */
-    fprintf(f, "c Cell constraints\n");
-    for(int i = 0; i < n; i++) {
-        for(int j = 0; j < n; j++) {
-            for(int k = 0; k < n; k++){
-                vars[k] = x(sudoku, i, j, k);
-            }
-            eo(f, vars, n);
-        }
+    const Backend* backend = opts.backend;
+    if (backend == NULL) {
+        backend = backend_pick(sudoku->n_values,
+                               opts.check_unique || opts.count_limit > 0
+                               ? BACKEND_CAN_ENUMERATE : 0);
+        printf("Backend: %s\n", backend->name);
     }
 
-    fprintf(f, "c Row constraints.\n");
-    /* YOUR CODE HERE */
-    for(int j = 0; j < n; j++) {
-        for(int k = 0; k < n; k++) {
-            for(int i = 0; i < n; i++){
-                vars[k] = x(sudoku, i, j, k);
-            }
-            eo(f, vars, n);
+    /* only the candidates left get a variable, with compact AMOs */
+    if (sudoku->n_values >= LARGE_GRID_VALUES
+        && (backend->caps & BACKEND_USES_CNF))
+    {
+        opts.prune = 1;
+        if (!amo_given) {
+            opts.amo_encoding = AMO_SEQUENTIAL;
         }
+        printf("Large grid: pruned encoding, %s AMO\n",
+               amo_encoding_name(opts.amo_encoding));
     }
 
+    /* the clock runs from here, encoding included */
+    Deadline deadline;
+    deadline_set(&deadline, opts.timeout);
 
-
-    fprintf(f, "c Column constraints.\n");
-    /* YOUR CODE HERE */
-    for(int i = 0; i < n; i++) {
-        for(int k = 0; k < n; k++) {
-            for(int j = 0; j < n; j++){
-                vars[k] = x(sudoku, i, j, k);
+    /* logic first, SAT only for what is left */
+    if (opts.presolve) {
+        int n_placed = 0;
+        PresolveResult pr = sudoku_presolve(sudoku, &n_placed);
+        printf("Presolver: %s, %d cells placed\n",
+               presolve_result_name(pr), n_placed);
+        if (pr == PRESOLVE_SOLVED) {
+            printf("Finished by: presolver\n");
+            sudoku_print(stdout, sudoku);
+            if (opts.check_unique) {  /* singles leave no alternative */
+                printf("Uniqueness: %s\n",
+                       uniqueness_name(UNIQUENESS_UNIQUE));
             }
-            eo(f, vars, n);
-        }
-    }
-
-    fprintf(f, "c Region constraints.\n");
-    /* YOUR CODE HERE */
-    const int l = sudoku->region_n_rows;
-    const int m = sudoku->region_n_cols;
-    for(int k = 0; k < n; k++){
-        for(int i = 0; i < m; i++){
-            for(int j = 0; j < l; j++){
-                vars[k] = x(sudoku, i, j, k);
+            sudoku_delete(sudoku);
+            return EXIT_SUCCESS;
+        } else if (pr == PRESOLVE_CONTRADICTION) {
+            printf("Finished by: presolver\nSudoku is UNSAT\n");
+            if (opts.check_unique) {
+                printf("Uniqueness: %s\n", uniqueness_name(UNIQUENESS_NONE));
             }
+            sudoku_delete(sudoku);
+            return EXIT_SUCCESS;
         }
-        eo(f, vars, n);
     }
 
-    fprintf(f, "c Fixed number constraints.\n");
-    /* YOUR CODE HERE */
-    int **cells = sudok,u->**cells;
-    for(int i = 0; i < n; i++) {
-        for(int j = 0; j < n; j++) {
-            int var = x(sudoku, i, j, cells[i][j]-1);
-            fprintf(f, "%d 0\n", var);
+    BackendOptions bopts = {
+        .amo_encoding = opts.amo_encoding,
+        .prune = opts.prune,
+        .commands = opts.commands,
+        .n_commands = opts.n_commands,
+        .instance_file = opts.instance_file,
+        .stream = opts.stream,
+        .log = stdout,
+    };
+    int uses_cnf = (backend->caps & BACKEND_USES_CNF) != 0;
+
+    if (opts.count_limit > 0) {
+        if (opts.check_unique && opts.count_limit < 2) {
+            opts.count_limit = 2;
         }
+        long n_solutions = 0;
+        RunSolverCode code = backend->enumerate(backend, sudoku, &bopts,
+                                                opts.count_limit,
+                                                &n_solutions,
+                                                _print_solution, NULL,
+                                                &deadline);
+        if (code == RUN_SOLVER_SAT || code == RUN_SOLVER_UNSAT
+            || code == RUN_SOLVER_UNKNOWN)
+        {
+            printf("Solutions: %ld%s\n", n_solutions,
+                   n_solutions >= opts.count_limit ? " (limit reached)"
+                   : deadline_expired(&deadline) ? " (deadline reached)" : "");
+        } else {
+            printf("something unexpected happened :(\n");
+        }
+        if (opts.check_unique && code != RUN_SOLVER_ERR_MEMORY) {
+            printf("Uniqueness: %s\n", uniqueness_name(
+                backend_count_uniqueness(code, n_solutions, &deadline)));
+        }
+        sudoku_delete(sudoku);
+        return EXIT_SUCCESS;
     }
 
-    /* formula created: clean up & close the instance file */
-    free(vars);
-    fclose(f);
+    /* encode & solve the formula, or search the grid directly */
+    BackendModel model = { { 0, NULL, NULL }, NULL };
+    Uniqueness uniqueness = UNIQUENESS_UNKNOWN;
+
+    RunSolverCode rs_code = backend->solve(backend, sudoku, &bopts,
+                                           &deadline,
+                                           opts.check_unique ? &uniqueness
+                                                             : NULL,
+                                           &model);
 
-    /* solve the formula */
-    int* model = (int*)malloc(sizeof(int) * num_vars);
-    /*RunSolverCode rs_code = run_solver("./glucose -model", "instance.cnf",
-                                         model);*/
-    RunSolverCode rs_code = run_solver("./picosat", "instance.cnf",
-                                       model);
     switch (rs_code) {
-        case RUN_SOLVER_SAT:   /* formula is SAT, a solution has been found */
-            printf("Formula is SAT. Model is:\n");
-            for (int i = 0; i < num_vars; ++i) {
-                printf("%d ", model[i]);
-            }
-            printf("\n");
-
-            /* fill sudoku->cells using the model here */
-            for(int i = 0; i < n; i++) {
-                for(int j = 0; j < n; j++) {
-                    for(int k = 0; k < n; k++) {
-                        if (model[i * n * n + j * n + k] > 0) {
-               	            sudoku->cells[i][j] = k+1;
-                        }
-                    }
+        case RUN_SOLVER_SAT:   /* a solution has been found */
+            if (model.values != NULL
+                && sudoku->n_values < LARGE_GRID_VALUES)
+            {
+                printf("Formula is SAT. Model is:\n");
+                for (int i = 0; i < model.map.n_vars; ++i) {
+                    printf("%d ", model.values[i]);
                 }
+                printf("\n");
+            } else if (model.values != NULL) {
+                printf("Formula is SAT\n");
             }
 
-            /* print the sudoku solution recovered from the model */
+            /* print the solution, already in sudoku->cells */
+            printf("Finished by: %s\n", backend->engine);
             sudoku_print(stdout, sudoku);
             break;
-        case RUN_SOLVER_UNSAT:  /* formula is UNSAT, there is no solution */
-            printf("Formula is UNSAT\n");
+        case RUN_SOLVER_UNSAT:  /* there is no solution */
+            printf(uses_cnf ? "Formula is UNSAT\n" : "Sudoku is UNSAT\n");
             break;
         case RUN_SOLVER_UNKNOWN:
-            printf("Solver reported UNKNOWN\n");
+            if (uses_cnf) {
+                printf("Solver reported UNKNOWN%s\n",
+                       deadline_n_fired() > 0 ? " (deadline reached)" : "");
+            } else {
+                printf("Deadline reached, no solution found\n");
+            }
             break;
         default:
             printf("something unexpected happened :(\n");
     }
+    if (opts.check_unique
+        && (rs_code == RUN_SOLVER_SAT || rs_code == RUN_SOLVER_UNSAT
+            || rs_code == RUN_SOLVER_UNKNOWN))
+    {
+        printf("Uniqueness: %s\n", uniqueness_name(uniqueness));
+    }
 
     /* clean up and exit */
-    free(model);
+    backend_model_release(&model);
     sudoku_delete(sudoku);
 
     return EXIT_SUCCESS;
@@ -0,0 +1,215 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "presolve.h"
+
+typedef uint64_t Mask;
+
+
+typedef struct
+{
+    Sudoku* sudoku;
+    Mask full;   /* one bit per value */
+    Mask* used;  /* values placed per unit: rows, columns, regions */
+    int n_empty;
+    int n_placed;
+} Presolver;
+
+
+/* Coordinates of the c-th cell of unit u: rows, then columns, then regions */
+static void _unit_cell(const Sudoku* s, int u, int c, int* i, int* j)
+{
+    const int n = s->n_values;
+    if (u < n) {
+        *i = u;
+        *j = c;
+    } else if (u < 2 * n) {
+        *i = c;
+        *j = u - n;
+    } else {
+        const int r = u - 2 * n;
+        const int per_band = n / s->region_n_cols;
+        *i = (r / per_band) * s->region_n_rows + c / s->region_n_cols;
+        *j = (r % per_band) * s->region_n_cols + c % s->region_n_cols;
+    }
+}
+
+
+static Mask _candidates(const Presolver* p, int i, int j)
+{
+    const int n = p->sudoku->n_values;
+    const Mask used = p->used[i] | p->used[n + j]
+                    | p->used[2 * n + sudoku_region(p->sudoku, i, j)];
+    return p->full & ~used;
+}
+
+
+/* Returns 0 if `k` was already placed in a unit of cell (i, j). */
+static int _place(Presolver* p, int i, int j, int k)
+{
+    const int n = p->sudoku->n_values;
+    const Mask bit = (Mask)1 << k;
+    const int units[3] = { i, n + j, 2 * n + sudoku_region(p->sudoku, i, j) };
+
+    int ok = 1;
+    for (int u = 0; u < 3; ++u) {
+        ok &= (p->used[units[u]] & bit) == 0;
+        p->used[units[u]] |= bit;
+    }
+    sudoku_set(p->sudoku, i, j, k + 1);
+    return ok;
+}
+
+
+static int _bit_index(Mask mask)
+{
+    return __builtin_ctzll(mask);
+}
+
+
+/* Returns the number of cells placed, or -1 on contradiction. */
+static int _naked_singles(Presolver* p)
+{
+    const int n = p->sudoku->n_values;
+    int placed = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if (sudoku_get(p->sudoku, i, j) != 0) {
+                continue;
+            }
+            const Mask cand = _candidates(p, i, j);
+            if (cand == 0) {
+                return -1;
+            } else if ((cand & (cand - 1)) == 0) {
+                _place(p, i, j, _bit_index(cand));
+                placed += 1;
+            }
+        }
+    }
+    return placed;
+}
+
+
+/* Returns the number of cells placed, or -1 on contradiction. */
+static int _hidden_singles(Presolver* p)
+{
+    const Sudoku* s = p->sudoku;
+    const int n = s->n_values;
+    int placed = 0;
+
+    for (int u = 0; u < 3 * n; ++u) {
+        /* values seen once and more than once among the unit's candidates */
+        Mask once = 0, twice = 0;
+        for (int c = 0; c < n; ++c) {
+            int i, j;
+            _unit_cell(s, u, c, &i, &j);
+            if (sudoku_get(s, i, j) == 0) {
+                const Mask cand = _candidates(p, i, j);
+                twice |= once & cand;
+                once |= cand;
+            }
+        }
+
+        const Mask missing = p->full & ~p->used[u];
+        if ((once & missing) != missing) {
+            return -1;  /* some value has no place left in the unit */
+        }
+
+        Mask singles = once & ~twice & missing;
+        while (singles != 0) {
+            const int k = _bit_index(singles);
+            singles &= singles - 1;
+            /* find the cell again; the unit may have changed meanwhile */
+            for (int c = 0; c < n; ++c) {
+                int i, j;
+                _unit_cell(s, u, c, &i, &j);
+                if (sudoku_get(s, i, j) == 0
+                    && (_candidates(p, i, j) & ((Mask)1 << k)) != 0)
+                {
+                    _place(p, i, j, k);
+                    placed += 1;
+                    break;
+                }
+            }
+        }
+    }
+    return placed;
+}
+
+
+PresolveResult sudoku_presolve(Sudoku* sudoku, int* n_placed)
+{
+    const int n = sudoku->n_values;
+    if (n_placed != NULL) {
+        *n_placed = 0;
+    }
+    if (n > PRESOLVE_MAX_VALUES) {
+        return PRESOLVE_REDUCED;
+    }
+
+    Presolver p;
+    p.sudoku = sudoku;
+    p.full = n == 64 ? ~(Mask)0 : ((Mask)1 << n) - 1;
+    p.used = (Mask*)calloc(3 * n, sizeof(Mask));
+    p.n_empty = 0;
+    p.n_placed = 0;
+    if (p.used == NULL) {
+        return PRESOLVE_ERR_MEMORY;
+    }
+
+    PresolveResult result = PRESOLVE_REDUCED;
+    for (int i = 0; i < n && result == PRESOLVE_REDUCED; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const int value = sudoku_get(sudoku, i, j);
+            if (value == 0) {
+                p.n_empty += 1;
+            } else if (!_place(&p, i, j, value - 1)) {
+                result = PRESOLVE_CONTRADICTION;
+                break;
+            }
+        }
+    }
+
+    while (result == PRESOLVE_REDUCED && p.n_placed < p.n_empty) {
+        int placed = _naked_singles(&p);
+        if (placed == 0) {
+            placed = _hidden_singles(&p);
+        }
+
+        if (placed < 0) {
+            result = PRESOLVE_CONTRADICTION;
+        } else if (placed == 0) {
+            break;
+        } else {
+            p.n_placed += placed;
+        }
+    }
+
+    if (result == PRESOLVE_REDUCED && p.n_placed == p.n_empty) {
+        result = PRESOLVE_SOLVED;
+    }
+
+    sudoku->n_fixed_cells += p.n_placed;
+    if (n_placed != NULL) {
+        *n_placed = p.n_placed;
+    }
+    free(p.used);
+    return result;
+}
+
+
+const char* presolve_result_name(PresolveResult result)
+{
+    switch (result) {
+        case PRESOLVE_SOLVED:
+            return "solved";
+        case PRESOLVE_REDUCED:
+            return "reduced";
+        case PRESOLVE_CONTRADICTION:
+            return "contradiction";
+        case PRESOLVE_ERR_MEMORY:
+            return "out of memory";
+        default:
+            return "unknown";
+    }
+}
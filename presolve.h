@@ -0,0 +1,32 @@
+#ifndef _PRESOLVE_H_
+#define _PRESOLVE_H_
+
+#include "sudoku.h"
+
+/* biggest grid the presolver handles, candidates are kept as 64-bit masks */
+#define PRESOLVE_MAX_VALUES 64
+
+typedef enum {
+    PRESOLVE_SOLVED,         /* every cell is filled, no SAT call needed */
+    PRESOLVE_REDUCED,        /* some (maybe no) cells were filled */
+    PRESOLVE_CONTRADICTION,  /* the fixed cells admit no solution */
+    PRESOLVE_ERR_MEMORY,
+} PresolveResult;
+
+/**
+ * Fills the cells of `sudoku` that follow from simple logic: naked singles
+ * (a cell with a single candidate) and hidden singles (a value with a single
+ * place left in a row, column or region), until neither applies. Candidates
+ * are tracked with per-row, per-column and per-region bitmasks.
+ *
+ * Grids with more than PRESOLVE_MAX_VALUES values are left untouched. If
+ * `n_placed` is not NULL it receives the number of cells filled.
+ */
+PresolveResult sudoku_presolve(Sudoku* sudoku, int* n_placed);
+
+/**
+ *
+ */
+const char* presolve_result_name(PresolveResult result);
+
+#endif
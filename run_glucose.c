@@ -0,0 +1,119 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "run_glucose.h"
+
+
+static void _glucose_add(CnfSink* sink, int lit)
+{
+    glucose_add((GlucoseSolver*)sink->data, lit);
+}
+
+
+void run_glucose_sink(CnfSink* sink, GlucoseSolver* gs)
+{
+    sink->add = _glucose_add;
+    sink->comment = NULL;
+    sink->data = gs;
+    sink->n_vars = 0;
+    sink->n_clauses = 0;
+    sink->amo_encoding = 0;
+}
+
+
+/* Thread interrupting a glucose_solve call once its deadline is over,
+ * glucose has no callback to poll one. */
+typedef struct {
+    GlucoseSolver* gs;
+    const Deadline* deadline;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int done;  /* the solve call has returned */
+} Watchdog;
+
+
+static void* _watchdog(void* arg)
+{
+    Watchdog* dog = (Watchdog*)arg;
+    pthread_mutex_lock(&dog->mutex);
+    while (!dog->done) {
+        int ret = pthread_cond_timedwait(&dog->cond, &dog->mutex,
+                                         &dog->deadline->at);
+        if (ret == ETIMEDOUT) {
+            if (!dog->done) {
+                glucose_interrupt(dog->gs);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&dog->mutex);
+    return NULL;
+}
+
+
+/* Runs glucose_solve under a Watchdog. Returns GLUCOSE_UNKNOWN without
+ * solving if the thread cannot be created. */
+static int _solve_until(GlucoseSolver* gs, const Deadline* deadline)
+{
+    Watchdog dog;
+    dog.gs = gs;
+    dog.deadline = deadline;
+    dog.done = 0;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);  /* as Deadline */
+    pthread_cond_init(&dog.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&dog.mutex, NULL);
+
+    int ret = GLUCOSE_UNKNOWN;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, _watchdog, &dog) == 0) {
+        ret = glucose_solve(gs);
+
+        pthread_mutex_lock(&dog.mutex);
+        dog.done = 1;
+        pthread_cond_signal(&dog.cond);
+        pthread_mutex_unlock(&dog.mutex);
+        pthread_join(thread, NULL);
+        /* the dog may have bitten after glucose_solve cleared the request
+         * and returned, which would stop the next solve on `gs` at once */
+        glucose_clear_interrupt(gs);
+    }
+
+    pthread_cond_destroy(&dog.cond);
+    pthread_mutex_destroy(&dog.mutex);
+    return ret;
+}
+
+
+RunSolverCode run_glucose(GlucoseSolver* gs, int* model, int n_vars,
+                          const Deadline* deadline)
+{
+    int ret = deadline != NULL && deadline->active
+              ? _solve_until(gs, deadline)
+              : glucose_solve(gs);
+
+    switch (ret) {
+        case GLUCOSE_SAT:
+            break;
+        case GLUCOSE_UNSAT:
+            return RUN_SOLVER_UNSAT;
+        default:
+            if (deadline_expired(deadline)) {
+                deadline_fired();
+            }
+            return RUN_SOLVER_UNKNOWN;
+    }
+
+    if (model != NULL) {
+        for (int v = 1; v <= n_vars; ++v) {
+            model[v - 1] = glucose_val(gs, v);
+        }
+        model[n_vars] = 0;
+    }
+    return RUN_SOLVER_SAT;
+}
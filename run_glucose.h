@@ -0,0 +1,28 @@
+#ifndef _RUN_GLUCOSE_H_
+#define _RUN_GLUCOSE_H_
+
+#include "cnf_sink.h"
+#include "glucose_c.h"
+#include "run_solver.h"
+
+/**
+ * Initializes `sink` to add every clause it receives straight to `gs`
+ * through glucose_add, with no intermediate file.
+ */
+void run_glucose_sink(CnfSink* sink, GlucoseSolver* gs);
+
+/**
+ * Solves the formula held by `gs` in-process. If it is satisfiable and
+ * `model` is not NULL, the assignment of the first `n_vars` variables is
+ * stored in `model`: the signed literal of variable v at model[v - 1],
+ * terminated with the dummy value 0.
+ *
+ * If `deadline` is not NULL, the search is interrupted once it is over
+ * and RUN_SOLVER_UNKNOWN is returned.
+ *
+ * Returns RUN_SOLVER_SAT, RUN_SOLVER_UNSAT or RUN_SOLVER_UNKNOWN.
+ */
+RunSolverCode run_glucose(GlucoseSolver* gs, int* model, int n_vars,
+                          const Deadline* deadline);
+
+#endif
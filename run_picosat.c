@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "run_picosat.h"
+
+
+static void _picosat_add(CnfSink* sink, int lit)
+{
+    picosat_add((PicoSAT*)sink->data, lit);
+}
+
+
+void run_picosat_sink(CnfSink* sink, PicoSAT* ps)
+{
+    sink->add = _picosat_add;
+    sink->comment = NULL;
+    sink->data = ps;
+    sink->n_vars = 0;
+    sink->n_clauses = 0;
+    sink->amo_encoding = 0;
+}
+
+
+/* Interrupt callback, picosat polls it every INTERRUPTLIM decisions. */
+static int _deadline_expired(void* deadline)
+{
+    return deadline_expired((const Deadline*)deadline);
+}
+
+
+RunSolverCode run_picosat(PicoSAT* ps, int* model, int n_vars,
+                          const Deadline* deadline)
+{
+    if (deadline != NULL && deadline->active) {
+        picosat_set_interrupt(ps, (void*)deadline, _deadline_expired);
+    }
+    int ret = picosat_sat(ps, -1);
+    picosat_set_interrupt(ps, NULL, NULL);
+
+    switch (ret) {
+        case PICOSAT_SATISFIABLE:
+            break;
+        case PICOSAT_UNSATISFIABLE:
+            return RUN_SOLVER_UNSAT;
+        default:
+            if (deadline_expired(deadline)) {
+                deadline_fired();
+            }
+            return RUN_SOLVER_UNKNOWN;
+    }
+
+    if (model != NULL) {
+        for (int v = 1; v <= n_vars; ++v) {
+            model[v - 1] = picosat_deref(ps, v) > 0 ? v : -v;
+        }
+        model[n_vars] = 0;
+    }
+    return RUN_SOLVER_SAT;
+}
@@ -0,0 +1,28 @@
+#ifndef _RUN_PICOSAT_H_
+#define _RUN_PICOSAT_H_
+
+#include "cnf_sink.h"
+#include "picosat.h"
+#include "run_solver.h"
+
+/**
+ * Initializes `sink` to add every clause it receives straight to `ps`
+ * through picosat_add, with no intermediate file.
+ */
+void run_picosat_sink(CnfSink* sink, PicoSAT* ps);
+
+/**
+ * Solves the formula held by `ps` in-process. If it is satisfiable and
+ * `model` is not NULL, the assignment of the first `n_vars` variables is
+ * stored in `model`: the signed literal of variable v at model[v - 1],
+ * terminated with the dummy value 0.
+ *
+ * If `deadline` is not NULL, the search is interrupted once it is over
+ * and RUN_SOLVER_UNKNOWN is returned.
+ *
+ * Returns RUN_SOLVER_SAT, RUN_SOLVER_UNSAT or RUN_SOLVER_UNKNOWN.
+ */
+RunSolverCode run_picosat(PicoSAT* ps, int* model, int n_vars,
+                          const Deadline* deadline);
+
+#endif
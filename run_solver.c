@@ -1,132 +1,443 @@
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "run_solver.h"
 
-const char* OUT_FILE_TEMPLATE = "solver_out.XXXXXX";
-const int PARSE_BUF_SIZE = 100;
+extern char** environ;
 
+#define READ_BUF_SIZE (64 * 1024)
+#define STATUS_BUF_SIZE 100  /* more than enough for the 's' line */
+#define KILL_GRACE_MS 100    /* SIGTERM to SIGKILL */
 
-static RunSolverCode _process_solver_result(FILE* solver_stream,
-                                            int *model)
+
+/* Line kinds of the solver output, by first character. */
+typedef enum { LINE_START, LINE_STATUS, LINE_VALUES, LINE_OTHER } LineKind;
+
+
+/* Scanner state of one solver output. A literal may be split between two
+ * reads, so the state lives across calls to _parser_feed. */
+typedef struct {
+    SolverModel* model;  /* NULL: the model is not needed */
+    RunSolverCode code;
+    LineKind line;
+    int model_done;
+    int in_literal;
+    int negative;
+    int value;
+    int status_len;
+    char status[STATUS_BUF_SIZE];
+} OutputParser;
+
+
+/* A solver taking part in the race. */
+typedef struct {
+    pid_t pid;
+    int fd;              /* read end of its stdout, -1 once finished */
+    char** argv;
+    SolverModel model;
+    OutputParser parser;
+} Racer;
+
+
+static void _parser_init(OutputParser* parser, SolverModel* model)
 {
-    if (fseek(solver_stream, 0L, SEEK_SET) == -1) {
-        return RUN_SOLVER_ERR_STREAM;
+    if (model != NULL) {  /* initialize model */
+        memset(model->values, 0, sizeof(int) * model->n_vars);
+        model->n_dropped = 0;
     }
 
-    if (model != NULL) { model[0] = 0; }  /* initialize model */
+    memset(parser, 0, sizeof(OutputParser));
+    parser->model = model;
+    parser->code = RUN_SOLVER_UNKNOWN;
+    parser->line = LINE_START;
+}
 
-    RunSolverCode code = RUN_SOLVER_UNKNOWN;
-    char buf[PARSE_BUF_SIZE];  /* more than enough for our purposes */
-    int model_index = 0;
-    int literal = 0;
 
-    for (buf[0] = fgetc(solver_stream);
-         !feof(solver_stream) && !ferror(solver_stream);
-         buf[0] = fgetc(solver_stream))
-    {
-        if (buf[0] == 's') {                          /* solution line */
-            fgets(buf, PARSE_BUF_SIZE, solver_stream);
-            if (strstr(buf, "UNSATISFIABLE") != NULL) {
-                code = RUN_SOLVER_UNSAT;
-            } else if (strstr(buf, "SATISFIABLE") != NULL) {
-                code = RUN_SOLVER_SAT;
+/* Stores `literal` in `model`, indexed by its variable. */
+static void _store_literal(SolverModel* model, int literal)
+{
+    const int v = literal > 0 ? literal : -literal;
+    if (v > model->n_vars) {
+        model->n_dropped += 1;
+    } else if (literal > 0 || !model->positive_only) {
+        model->values[v - 1] = literal;
+    }
+}
+
+
+/* Feeds `n` bytes of solver output to `parser`. Returns 1 as soon as the
+ * answer is complete: the 's' line and, for satisfiable instances, the
+ * whole model (when it is needed); whatever follows is not looked at.
+ * Also returns 1, with RUN_SOLVER_ERR_STREAM, on a literal past INT_MAX. */
+static int _parser_feed(OutputParser* parser, const char* data, size_t n)
+{
+    for (size_t p = 0; p < n; ++p) {
+        const char c = data[p];
+
+        if (parser->line == LINE_START) {
+            if (c == 's') {
+                parser->line = LINE_STATUS;
+                parser->status_len = 0;
+            } else if (c == 'v' && parser->model != NULL) {
+                parser->line = LINE_VALUES;
+            } else if (c != '\n') {
+                parser->line = LINE_OTHER;
             }
-        } else if (buf[0] == 'v' && model != NULL) {  /* model line */
-            int n_matches = fscanf(solver_stream, "%d", &literal);
-            while (n_matches == 1) {
-                if (literal == 0) {
-                    break;
+            continue;
+        }
+
+        if (parser->line == LINE_VALUES) {
+            if (c >= '0' && c <= '9') {
+                if (parser->value > (INT_MAX - (c - '0')) / 10) {
+                    /* no variable is that big, the output is broken */
+                    parser->code = RUN_SOLVER_ERR_STREAM;
+                    return 1;
+                }
+                parser->in_literal = 1;
+                parser->value = parser->value * 10 + (c - '0');
+                continue;
+            } else if (c == '-') {
+                parser->negative = 1;
+                continue;
+            }
+            if (parser->in_literal) {  /* a blank ends the literal */
+                if (parser->value == 0) {
+                    parser->model_done = 1;
                 } else {
-                    model[model_index++] = literal;
-                    n_matches = fscanf(solver_stream, "%d", &literal);
+                    _store_literal(parser->model, parser->negative
+                                                  ? -parser->value
+                                                  : parser->value);
                 }
             }
-        } else if (!isspace(buf[0])) {                /* consume line */
-            while (fgetc(solver_stream) != '\n') {
-                if (feof(solver_stream) || ferror(solver_stream)) {
-                    break;
+            parser->in_literal = 0;
+            parser->negative = 0;
+            parser->value = 0;
+        } else if (parser->line == LINE_STATUS && c != '\n') {
+            if (parser->status_len < STATUS_BUF_SIZE - 1) {
+                parser->status[parser->status_len++] = c;
+            }
+        }
+
+        if (c == '\n') {
+            if (parser->line == LINE_STATUS) {
+                parser->status[parser->status_len] = '\0';
+                if (strstr(parser->status, "UNSATISFIABLE") != NULL) {
+                    parser->code = RUN_SOLVER_UNSAT;
+                } else if (strstr(parser->status, "SATISFIABLE") != NULL) {
+                    parser->code = RUN_SOLVER_SAT;
                 }
             }
+            parser->line = LINE_START;
+        }
+
+        if (parser->code == RUN_SOLVER_UNSAT
+            || (parser->code == RUN_SOLVER_SAT
+                && (parser->model == NULL || parser->model_done)))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/* Splits `command` on blanks and appends `instance`: the argv of the
+ * solver. Both the returned array and argv[0] must be freed. */
+static char** _make_argv(const char* command, const char* instance)
+{
+    char* words = strdup(command);
+    if (words == NULL) {
+        return NULL;
+    }
+
+    size_t n_words = 0;
+    for (const char* c = command; *c != '\0'; ++c) {
+        if (!isspace((unsigned char)*c)
+            && (c == command || isspace((unsigned char)c[-1])))
+        {
+            n_words += 1;
         }
     }
 
-    if (ferror(solver_stream)) {  /* correct code in case of IO error */
-        code = RUN_SOLVER_ERR_STREAM;
+    char** argv = (char**)malloc((n_words + 2) * sizeof(char*));
+    if (argv == NULL) {
+        free(words);
+        return NULL;
     }
-    return code;
+
+    size_t argc = 0;
+    char* save = NULL;
+    for (char* w = strtok_r(words, " \t\n", &save); w != NULL;
+         w = strtok_r(NULL, " \t\n", &save))
+    {
+        argv[argc++] = w;
+    }
+    if (argc == 0) {  /* no solver at all */
+        free(words);
+        free(argv);
+        return NULL;
+    }
+    argv[argc++] = (char*)instance;
+    argv[argc] = NULL;
+    return argv;
 }
 
 
-static RunSolverCode _run_solver(const char* command, FILE* solver_stream,
-                                 int *model)
+/* Spawns the solver of `racer` with its stdout connected to a pipe.
+ * Returns RUN_SOLVER_SAT on success, otherwise the error code the racer
+ * finishes with. */
+static RunSolverCode _spawn(Racer* racer)
 {
-    int sys_code = system(NULL);
-    if (sys_code == 0) {
-        return RUN_SOLVER_ERR_NO_SHELL;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return RUN_SOLVER_ERR_STREAM;
     }
+    /* the other solvers of the race must not inherit this pipe, its read
+     * end would never see EOF */
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    /* the solver writes its stdout to the pipe, no shell in between */
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
 
-    sys_code = system(command);
-    if (sys_code == -1) {
+    int spawn_ret = posix_spawnp(&racer->pid, racer->argv[0], &actions, NULL,
+                                 racer->argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (spawn_ret != 0) {
+        racer->pid = 0;
+        close(fds[0]);
         return RUN_SOLVER_ERR_CHILD;
     }
+    racer->fd = fds[0];
+    return RUN_SOLVER_SAT;
+}
+
 
-    return _process_solver_result(solver_stream, model);
+/* Reads what is available from `racer`. Returns 1 once it has finished,
+ * with an answer or without one. */
+static int _read_racer(Racer* racer, char* buf)
+{
+    ssize_t n_read = read(racer->fd, buf, READ_BUF_SIZE);
+    if (n_read < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+            return 0;
+        }
+        racer->parser.code = RUN_SOLVER_ERR_STREAM;
+        return 1;
+    } else if (n_read == 0) {  /* the output may lack the final newline */
+        OutputParser* parser = &racer->parser;
+        _parser_feed(parser, "\n", 1);
+        if (parser->code == RUN_SOLVER_SAT && parser->model != NULL
+            && !parser->model_done)
+        {
+            /* SAT without a whole model is no answer, others may give one */
+            parser->code = RUN_SOLVER_ERR_STREAM;
+        }
+        return 1;
+    }
+    return _parser_feed(&racer->parser, buf, (size_t)n_read);
 }
 
 
-RunSolverCode run_solver(const char* solver, const char* instance, int *model)
+/* Stops the solvers still alive in `racers` and reaps them all: SIGTERM
+ * first, SIGKILL for those that did not exit within KILL_GRACE_MS. */
+static void _terminate(Racer* racers, int n_racers)
 {
-    const size_t solver_len = strlen(solver);
-    const size_t instance_len = strlen(instance);
-    const size_t out_file_len = strlen(OUT_FILE_TEMPLATE);
-    const size_t n_separators = 5;  // two spaces + " > "
-    const size_t command_len = solver_len + instance_len
-                             + out_file_len + n_separators;
+    int n_alive = 0;
+    for (int r = 0; r < n_racers; ++r) {
+        if (racers[r].pid > 0) {
+            kill(racers[r].pid, SIGTERM);
+            n_alive += 1;
+        }
+    }
 
-    const size_t out_file_size = (out_file_len + 1) * sizeof(char);
-    const size_t command_size = (command_len + 1) * sizeof(char);
+    const struct timespec tick = { 0, 1000000L };  /* 1 ms */
+    for (int ms = 0; n_alive > 0 && ms < KILL_GRACE_MS; ++ms) {
+        for (int r = 0; r < n_racers; ++r) {
+            if (racers[r].pid > 0
+                && waitpid(racers[r].pid, NULL, WNOHANG) == racers[r].pid)
+            {
+                racers[r].pid = 0;
+                n_alive -= 1;
+            }
+        }
+        if (n_alive > 0) {
+            nanosleep(&tick, NULL);
+        }
+    }
 
-    RunSolverCode code = RUN_SOLVER_UNKNOWN;
-    FILE* solver_stream = NULL;
+    for (int r = 0; r < n_racers; ++r) {
+        if (racers[r].pid > 0) {
+            kill(racers[r].pid, SIGKILL);
+            while (waitpid(racers[r].pid, NULL, 0) < 0 && errno == EINTR) {
+                /* retry */
+            }
+            racers[r].pid = 0;
+        }
+    }
+}
 
-    /* allocate memory */
-    char *out_file = (char*)malloc(out_file_size);
-    char *command = (char*)malloc(command_size);
-    if (out_file == NULL || command == NULL) {
-        code = RUN_SOLVER_ERR_MEMORY;
-        goto done;
+
+/***** Public functions *****/
+
+RunSolverCode run_solver(const char* solver, const char* instance,
+                         SolverModel* model, const Deadline* deadline)
+{
+    return run_solver_race(&solver, 1, instance, model, deadline, NULL);
+}
+
+
+RunSolverCode run_solver_race(const char* const* solvers, int n_solvers,
+                              const char* instance, SolverModel* model,
+                              const Deadline* deadline, int* winner)
+{
+    Racer* racers = (Racer*)calloc(n_solvers, sizeof(Racer));
+    struct pollfd* pfds = (struct pollfd*)malloc(sizeof(struct pollfd)
+                                                 * n_solvers);
+    int* poll_racer = (int*)malloc(sizeof(int) * n_solvers);
+    char* buf = (char*)malloc(READ_BUF_SIZE);
+    if (racers == NULL || pfds == NULL || poll_racer == NULL || buf == NULL) {
+        free(racers);
+        free(pfds);
+        free(poll_racer);
+        free(buf);
+        return RUN_SOLVER_ERR_MEMORY;
     }
 
-    /* create temporary file */
-    strcpy(out_file, OUT_FILE_TEMPLATE);
-    int solver_stream_fd = mkstemp(out_file);
-    if (solver_stream_fd < 0) {
-        code = RUN_SOLVER_ERR_STREAM;
-        goto done;
+    RunSolverCode code = RUN_SOLVER_UNKNOWN;
+    int n_running = 0;
+    int first = -1;  /* racer with the first definitive answer */
+    int last = -1;   /* last racer to finish */
+    int expired = 0;
+
+    for (int r = 0; r < n_solvers; ++r) {
+        Racer* racer = &racers[r];
+        racer->fd = -1;
+
+        /* each solver fills its own model and the winner's one is kept;
+         * the first solver writes straight into the caller's */
+        SolverModel* racer_model = NULL;
+        if (model != NULL) {
+            racer->model = *model;
+            if (r > 0) {
+                racer->model.values = (int*)malloc(sizeof(int)
+                                                   * model->n_vars);
+            }
+            racer_model = &racer->model;
+        }
+
+        racer->argv = _make_argv(solvers[r], instance);
+        if (racer->argv == NULL
+            || (model != NULL && racer->model.values == NULL))
+        {
+            racer->parser.code = RUN_SOLVER_ERR_MEMORY;
+        } else {
+            _parser_init(&racer->parser, racer_model);
+            RunSolverCode spawn_code = _spawn(racer);
+            if (spawn_code != RUN_SOLVER_SAT) {
+                racer->parser.code = spawn_code;
+            } else {
+                n_running += 1;
+            }
+        }
+        if (racer->fd < 0) {
+            last = r;
+        }
     }
-    solver_stream = fdopen(solver_stream_fd, "r");  /* should never fail */
 
-    /* make command, enough memory was allocated previously */
-    strcpy(command, solver);
-    strcat(command, " ");
-    strcat(command, instance);
-    strcat(command, " ");
-    strcat(command, " > ");
-    strcat(command, out_file);
+    /* the first definitive answer wins */
+    while (n_running > 0 && first < 0) {
+        int n_pfds = 0;
+        for (int r = 0; r < n_solvers; ++r) {
+            if (racers[r].fd >= 0) {
+                pfds[n_pfds].fd = racers[r].fd;
+                pfds[n_pfds].events = POLLIN;
+                poll_racer[n_pfds++] = r;
+            }
+        }
+
+        int n_ready = poll(pfds, n_pfds, deadline_ms_left(deadline));
+        if (n_ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            code = RUN_SOLVER_ERR_STREAM;
+            break;
+        } else if (n_ready == 0 && deadline_expired(deadline)) {
+            deadline_fired();
+            expired = 1;
+            break;
+        }
 
-    /* run solver (for real) */
-    code = _run_solver(command, solver_stream, model);
+        for (int p = 0; p < n_pfds && first < 0; ++p) {
+            Racer* racer = &racers[poll_racer[p]];
+            if (pfds[p].revents == 0 || !_read_racer(racer, buf)) {
+                continue;
+            }
 
-done:
-    if (solver_stream != NULL) {
-        fclose(solver_stream);  /* closes O.S level fd */
-        remove(out_file);
+            close(racer->fd);
+            racer->fd = -1;
+            n_running -= 1;
+            last = poll_racer[p];
+            if (racer->parser.code == RUN_SOLVER_SAT
+                || racer->parser.code == RUN_SOLVER_UNSAT)
+            {
+                first = poll_racer[p];
+            }
+        }
+    }
+
+    if (first >= 0) {
+        code = racers[first].parser.code;
+        if (model != NULL) {
+            if (first > 0) {
+                memcpy(model->values, racers[first].model.values,
+                       sizeof(int) * model->n_vars);
+            }
+            model->n_dropped = racers[first].model.n_dropped;
+        }
+    } else if (last >= 0 && code == RUN_SOLVER_UNKNOWN && !expired) {
+        code = racers[last].parser.code;  /* nobody answered */
+    }
+    if (winner != NULL) {
+        *winner = first;
+    }
+
+    /* the answer is in (or the time is over), do not wait for the others
+     * nor for the winner's statistics */
+    _terminate(racers, n_solvers);
+    for (int r = 0; r < n_solvers; ++r) {
+        Racer* racer = &racers[r];
+        if (racer->fd >= 0) {
+            close(racer->fd);
+        }
+        if (racer->argv != NULL) {
+            free(racer->argv[0]);
+            free(racer->argv);
+        }
+        if (r > 0 && model != NULL) {
+            free(racer->model.values);
+        }
     }
 
-    free(out_file);
-    free(command);
+    free(racers);
+    free(pfds);
+    free(poll_racer);
+    free(buf);
     return code;
 }
@@ -2,26 +2,69 @@
 #ifndef _RUN_SOLVER_H_
 #define _RUN_SOLVER_H_
 
+#include "deadline.h"
+
 typedef enum {
     RUN_SOLVER_SAT,
     RUN_SOLVER_UNSAT,
     RUN_SOLVER_UNKNOWN,
     RUN_SOLVER_ERR_MEMORY,   /* could not allocate memory */
-    RUN_SOLVER_ERR_STREAM,   /* could not create/read the result file */
-    RUN_SOLVER_ERR_NO_SHELL, /* system() cannot be executed (not supported) */
-    RUN_SOLVER_ERR_CHILD,    /* system() could not run the command */
+    RUN_SOLVER_ERR_STREAM,   /* could not create/read the solver output */
+    RUN_SOLVER_ERR_NO_SHELL, /* unused, solvers are no longer run by a shell */
+    RUN_SOLVER_ERR_CHILD,    /* the solver process could not be spawned */
 } RunSolverCode;
 
+/**
+ * Model reported by an external solver, indexed by variable: after a
+ * satisfiable run `values[v - 1]` is `v` when the variable is true, `-v`
+ * when it is false (0 when `positive_only` is set) and 0 when the solver
+ * did not report it.
+ *
+ * Only variables 1..`n_vars` are stored; literals of larger variables are
+ * not written anywhere but counted in `n_dropped`, so that a too small
+ * buffer (or a solver reporting unknown variables) can be detected.
+ */
+typedef struct {
+    int* values;        /* room for `n_vars` values */
+    int n_vars;
+    int positive_only;  /* skip false variables, callers only test `> 0` */
+    int n_dropped;      /* set by run_solver */
+} SolverModel;
+
 /**
  * Runs the provided solver on `instance`. If `instance` is satisfiable
  * and `model` is not NULL, the variables assignment is stored in `model`.
  *
- * `model` will always be terminated with the dummy value '0', thereby it must
- * have enough room to fit all the variables plus 1.
+ * `solver` is split on blanks into the program (searched in PATH) and its
+ * arguments, `instance` is appended as the last argument. The solver is
+ * spawned directly, without a shell, and its output is parsed from a pipe
+ * as it streams; once the answer is complete the solver is terminated.
+ *
+ * If `deadline` is not NULL and it is over before the answer arrives, the
+ * solver is stopped (SIGTERM, then SIGKILL if it does not exit promptly)
+ * and RUN_SOLVER_UNKNOWN is returned.
  *
  * Any return code different from RUN_SOLVER_SAT, RUN_SOLVER_UNSAT and
  * RUN_SOLVER_UNKNOWN, indicates that an error ocurred.
  */
-RunSolverCode run_solver(const char* solver, const char* instance, int *model);
+RunSolverCode run_solver(const char* solver, const char* instance,
+                         SolverModel* model, const Deadline* deadline);
+
+/**
+ * Races `n_solvers` solvers on `instance`: all of them are spawned at once
+ * (as in run_solver) and the first definitive answer, SAT or UNSAT, is
+ * returned together with its model. The rest of the solvers are killed
+ * as soon as it arrives, so the latency follows the fastest solver on
+ * each instance. `deadline` applies to the race as a whole. Running the
+ * same solver several times with different seeds is a valid portfolio.
+ *
+ * If `winner` is not NULL, the index of the solver that answered is stored
+ * in it, -1 if none did. In that case the code of the last solver to
+ * finish is returned (RUN_SOLVER_UNKNOWN or an error), or
+ * RUN_SOLVER_UNKNOWN if the deadline is over.
+ */
+RunSolverCode run_solver_race(const char* const* solvers, int n_solvers,
+                              const char* instance, SolverModel* model,
+                              const Deadline* deadline, int* winner);
 
 #endif
@@ -0,0 +1,699 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "server.h"
+#include "sudoku_reader.h"
+
+/* longest request line, a grid of 35 values takes 1225 characters */
+#define MAX_LINE 4096
+
+#define READ_SIZE 65536
+
+/* room for the words around the solution of an answer */
+#define ANSWER_EXTRA 128
+
+
+typedef struct Server Server;
+typedef struct Client Client;
+
+/* A request, in the ring of its client and in the work queue. */
+typedef struct Request
+{
+    BatchResult result;
+    Client* client;
+    const char* error;     /* why it is a bad request, NULL if solved */
+    int done;              /* answer ready, guarded by Client.mutex */
+    struct Request* next;  /* in Server.queue */
+} Request;
+
+
+struct Client
+{
+    Server* server;
+    pthread_t writer;  /* writes the answers, the client thread reads */
+    int in_fd;
+    int out_fd;        /* in_fd too for a socket */
+    int is_socket;
+    long n_requests;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;  /* a request is done, a slot is free or eof */
+    Request* ring;        /* Server.config->max_pending slots */
+    int head;
+    int count;
+    int eof;              /* no more requests will come */
+
+    char line[MAX_LINE];  /* request being read */
+    struct Client* next;  /* in Server.clients */
+};
+
+
+typedef struct
+{
+    pthread_t thread;
+    Server* server;
+    BatchPool pool;  /* kept for the whole run */
+} Worker;
+
+
+struct Server
+{
+    const ServerConfig* config;
+    ServerStats* stats;  /* guarded by mutex */
+    Worker* workers;
+    int n_workers;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;    /* requests queued or closing */
+    pthread_cond_t client_cond;  /* a client left or stopping */
+    Request* queue_head;
+    Request* queue_tail;
+    int closing;                 /* the workers may quit */
+    int stopping;                /* no more clients are accepted */
+    Client* clients;
+    int n_clients;
+    int listen_fd;
+};
+
+
+/***** Private functions *****/
+
+static int _write_all(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+
+static void _queue_push(Server* server, Request* request)
+{
+    pthread_mutex_lock(&server->mutex);
+    request->next = NULL;
+    if (server->queue_tail == NULL) {
+        server->queue_head = request;
+    } else {
+        server->queue_tail->next = request;
+    }
+    server->queue_tail = request;
+    pthread_cond_signal(&server->work_cond);
+    pthread_mutex_unlock(&server->mutex);
+}
+
+
+static void* _worker_main(void* arg)
+{
+    Worker* worker = (Worker*)arg;
+    Server* server = worker->server;
+    const ServerConfig* config = server->config;
+
+    if (config->warm_region_n_rows > 0) {
+        batch_driver_warm(&config->batch, &worker->pool,
+                          config->warm_region_n_rows,
+                          config->warm_region_n_cols);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&server->mutex);
+        while (server->queue_head == NULL && !server->closing) {
+            pthread_cond_wait(&server->work_cond, &server->mutex);
+        }
+        Request* request = server->queue_head;
+        if (request != NULL) {
+            server->queue_head = request->next;
+            if (server->queue_head == NULL) {
+                server->queue_tail = NULL;
+            }
+        }
+        pthread_mutex_unlock(&server->mutex);
+        if (request == NULL) {
+            break;
+        }
+
+        batch_driver_solve(&config->batch, &worker->pool, &request->result);
+
+        Client* client = request->client;
+        pthread_mutex_lock(&client->mutex);
+        request->done = 1;
+        pthread_cond_broadcast(&client->cond);
+        pthread_mutex_unlock(&client->mutex);
+    }
+    return NULL;
+}
+
+
+/* Appends the answer line of `request` to `out`. */
+static size_t _format_answer(const Server* server, const Request* request,
+                             char* out)
+{
+    const BatchResult* result = &request->result;
+    if (request->error != NULL) {
+        return (size_t)sprintf(out, "ERROR %s\n", request->error);
+    }
+
+    switch (result->code) {
+        case RUN_SOLVER_SAT: {
+            size_t len = (size_t)sprintf(out, "SAT ");
+            len += (size_t)sudoku_format_line(result->sudoku, out + len);
+            if (server->config->batch.check_unique) {
+                len += (size_t)sprintf(out + len, " %s",
+                                       uniqueness_name(result->uniqueness));
+            }
+            out[len++] = '\n';
+            return len;
+        }
+        case RUN_SOLVER_UNSAT:
+            return (size_t)sprintf(out, "UNSAT\n");
+        case RUN_SOLVER_UNKNOWN:
+            return (size_t)sprintf(out, "UNKNOWN\n");
+        default:
+            return (size_t)sprintf(out, "ERROR solver failed (code %d)\n",
+                                   result->code);
+    }
+}
+
+
+static void _count_answer(Server* server, const Request* request)
+{
+    ServerStats* stats = server->stats;
+    pthread_mutex_lock(&server->mutex);
+    stats->n_requests += 1;
+    if (request->error != NULL) {
+        stats->n_errors += 1;
+    } else if (request->result.code == RUN_SOLVER_SAT) {
+        stats->n_sat += 1;
+    } else if (request->result.code == RUN_SOLVER_UNSAT) {
+        stats->n_unsat += 1;
+    } else if (request->result.code == RUN_SOLVER_UNKNOWN) {
+        stats->n_unknown += 1;
+    } else {
+        stats->n_errors += 1;
+    }
+    pthread_mutex_unlock(&server->mutex);
+}
+
+
+/* Writes the answers in request order, every one that is ready in a single
+ * write. Once the client stops reading, answers are dropped, and a socket
+ * is shut down for reading so the requests stop too. */
+static void* _writer_main(void* arg)
+{
+    Client* client = (Client*)arg;
+    Server* server = client->server;
+    const int max_pending = server->config->max_pending;
+    char* out = NULL;
+    size_t out_size = 0;
+    int broken = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&client->mutex);
+        while (!(client->count > 0 && client->ring[client->head].done)
+               && !(client->eof && client->count == 0))
+        {
+            pthread_cond_wait(&client->cond, &client->mutex);
+        }
+        /* the ready answers, the reader only ever adds behind them */
+        int n_ready = 0;
+        while (n_ready < client->count
+               && client->ring[(client->head + n_ready) % max_pending].done)
+        {
+            n_ready += 1;
+        }
+        const int head = client->head;
+        pthread_mutex_unlock(&client->mutex);
+        if (n_ready == 0) {
+            break;  /* eof and nothing left */
+        }
+
+        size_t len = 0;
+        for (int k = 0; k < n_ready && !broken; ++k) {
+            const Request* request = &client->ring[(head + k) % max_pending];
+            const size_t need = len + request->result.sudoku->n_cells
+                                + ANSWER_EXTRA;
+            if (need > out_size) {
+                char* grown = (char*)realloc(out, need * 2);
+                if (grown == NULL) {
+                    broken = 1;
+                    break;
+                }
+                out = grown;
+                out_size = need * 2;
+            }
+            len += _format_answer(server, request, out + len);
+        }
+        if (!broken && _write_all(client->out_fd, out, len) != 0) {
+            broken = 1;
+        }
+        if (broken && client->is_socket) {
+            shutdown(client->in_fd, SHUT_RD);
+        }
+
+        for (int k = 0; k < n_ready; ++k) {
+            _count_answer(server, &client->ring[(head + k) % max_pending]);
+        }
+        pthread_mutex_lock(&client->mutex);
+        client->head = (head + n_ready) % max_pending;
+        client->count -= n_ready;
+        pthread_cond_broadcast(&client->cond);
+        pthread_mutex_unlock(&client->mutex);
+    }
+
+    free(out);
+    return NULL;
+}
+
+
+static int _is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+/* Queues the request in the `len` characters of `text`, waiting for a free
+ * slot. Blank and comment lines are no request. */
+static void _submit(Client* client, const char* text, size_t len,
+                    int too_long)
+{
+    size_t start = 0;
+    while (start < len && _is_blank(text[start])) {
+        start += 1;
+    }
+    if (!too_long && (start == len || text[start] == '#')) {
+        return;
+    }
+
+    const int max_pending = client->server->config->max_pending;
+    pthread_mutex_lock(&client->mutex);
+    while (client->count == max_pending) {
+        pthread_cond_wait(&client->cond, &client->mutex);
+    }
+    Request* request = &client->ring[(client->head + client->count)
+                                     % max_pending];
+    pthread_mutex_unlock(&client->mutex);
+
+    client->n_requests += 1;
+    request->result.line = client->n_requests;
+    request->result.code = RUN_SOLVER_UNKNOWN;
+    request->result.stage = NULL;
+    request->error = NULL;
+    if (too_long) {
+        request->error = "line too long";
+    } else {
+        int error_code = sudoku_parse_line(text + start, len - start,
+                                           request->result.sudoku);
+        if (error_code != NO_ERROR) {
+            request->error = sudoku_translate_error_code(error_code);
+        }
+    }
+    request->result.error_code = NO_ERROR;
+    request->done = request->error != NULL;
+
+    pthread_mutex_lock(&client->mutex);
+    client->count += 1;
+    pthread_cond_broadcast(&client->cond);
+    pthread_mutex_unlock(&client->mutex);
+
+    if (request->error == NULL) {
+        _queue_push(client->server, request);
+    }
+}
+
+
+static void _read_requests(Client* client)
+{
+    char chunk[READ_SIZE];
+    size_t len = 0;
+    int too_long = 0;
+
+    for (;;) {
+        ssize_t n = read(client->in_fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            break;
+        }
+
+        const char* p = chunk;
+        const char* end = chunk + n;
+        while (p < end) {
+            const char* nl = memchr(p, '\n', (size_t)(end - p));
+            const size_t piece = (size_t)((nl != NULL ? nl : end) - p);
+            if (len + piece > MAX_LINE) {
+                too_long = 1;
+            } else {
+                memcpy(client->line + len, p, piece);
+                len += piece;
+            }
+            if (nl == NULL) {
+                break;
+            }
+            _submit(client, client->line, len, too_long);
+            len = 0;
+            too_long = 0;
+            p = nl + 1;
+        }
+    }
+    if (len > 0 || too_long) {  /* last line, without a newline */
+        _submit(client, client->line, len, too_long);
+    }
+}
+
+
+static void _client_delete(Client* client, int n_slots)
+{
+    for (int s = 0; s < n_slots; ++s) {
+        if (client->ring[s].result.sudoku != NULL) {
+            sudoku_delete(client->ring[s].result.sudoku);
+        }
+    }
+    free(client->ring);
+    pthread_cond_destroy(&client->cond);
+    pthread_mutex_destroy(&client->mutex);
+    free(client);
+}
+
+
+static Client* _client_new(Server* server, int in_fd, int out_fd,
+                           int is_socket)
+{
+    const int max_pending = server->config->max_pending;
+    Client* client = (Client*)calloc(1, sizeof(Client));
+    if (client == NULL) {
+        return NULL;
+    }
+    client->server = server;
+    client->in_fd = in_fd;
+    client->out_fd = out_fd;
+    client->is_socket = is_socket;
+    pthread_mutex_init(&client->mutex, NULL);
+    pthread_cond_init(&client->cond, NULL);
+
+    client->ring = (Request*)calloc(max_pending, sizeof(Request));
+    int ok = client->ring != NULL;
+    for (int s = 0; s < max_pending && ok; ++s) {
+        client->ring[s].client = client;
+        client->ring[s].result.sudoku = sudoku_new();
+        ok = client->ring[s].result.sudoku != NULL;
+    }
+    if (!ok) {
+        _client_delete(client, client->ring != NULL ? max_pending : 0);
+        return NULL;
+    }
+    return client;
+}
+
+
+/* Serves `client` until the end of its requests, then releases it. */
+static void _serve(Client* client)
+{
+    Server* server = client->server;
+    if (pthread_create(&client->writer, NULL, _writer_main, client) == 0) {
+        _read_requests(client);
+
+        pthread_mutex_lock(&client->mutex);
+        client->eof = 1;
+        pthread_cond_broadcast(&client->cond);
+        pthread_mutex_unlock(&client->mutex);
+        pthread_join(client->writer, NULL);
+    }
+
+    /* off the list before the descriptor may be reused */
+    pthread_mutex_lock(&server->mutex);
+    Client** link = &server->clients;
+    while (*link != NULL && *link != client) {
+        link = &(*link)->next;
+    }
+    if (*link != NULL) {
+        *link = client->next;
+    }
+    server->n_clients -= 1;
+    pthread_cond_broadcast(&server->client_cond);
+    pthread_mutex_unlock(&server->mutex);
+
+    if (client->is_socket) {
+        close(client->in_fd);
+    }
+    _client_delete(client, server->config->max_pending);
+}
+
+
+static void* _client_main(void* arg)
+{
+    _serve((Client*)arg);
+    return NULL;
+}
+
+
+/* Waits for SIGINT or SIGTERM (blocked in every thread), then stops the
+ * server: accept() is woken up by shutting the listening socket down and
+ * the clients stop reading, so what they sent is still answered. */
+static void* _signal_main(void* arg)
+{
+    Server* server = (Server*)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    int sig;
+    sigwait(&set, &sig);
+
+    pthread_mutex_lock(&server->mutex);
+    server->stopping = 1;
+    shutdown(server->listen_fd, SHUT_RDWR);
+    for (Client* c = server->clients; c != NULL; c = c->next) {
+        shutdown(c->in_fd, SHUT_RD);
+    }
+    pthread_cond_broadcast(&server->client_cond);
+    pthread_mutex_unlock(&server->mutex);
+    return NULL;
+}
+
+
+/* Binds a listening socket at `path`, replacing a socket left behind by a
+ * server that is gone. A live server or another kind of file is an
+ * error. */
+static int _listen(const char* path, int backlog)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            close(fd);
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path);
+    }
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0
+        || listen(fd, backlog) != 0)
+    {
+        const int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+
+static int _accept_clients(Server* server, const char* path)
+{
+    const ServerConfig* config = server->config;
+    server->listen_fd = _listen(path, config->max_clients);
+    if (server->listen_fd < 0) {
+        return -1;
+    }
+
+    pthread_t signal_thread;
+    if (pthread_create(&signal_thread, NULL, _signal_main, server) != 0) {
+        close(server->listen_fd);
+        unlink(path);
+        return -1;
+    }
+
+    int ret = 0;
+    for (;;) {
+        pthread_mutex_lock(&server->mutex);
+        while (server->n_clients >= config->max_clients
+               && !server->stopping)
+        {
+            pthread_cond_wait(&server->client_cond, &server->mutex);
+        }
+        const int stopping = server->stopping;
+        pthread_mutex_unlock(&server->mutex);
+        if (stopping) {
+            break;
+        }
+
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            pthread_mutex_lock(&server->mutex);
+            ret = server->stopping ? 0 : -1;
+            pthread_mutex_unlock(&server->mutex);
+            break;
+        }
+
+        Client* client = _client_new(server, fd, fd, 1);
+        pthread_t thread;
+        pthread_mutex_lock(&server->mutex);
+        if (client != NULL && !server->stopping
+            && pthread_create(&thread, NULL, _client_main, client) == 0)
+        {
+            pthread_detach(thread);
+            client->next = server->clients;
+            server->clients = client;
+            server->n_clients += 1;
+            server->stats->n_clients += 1;
+            client = NULL;
+        }
+        pthread_mutex_unlock(&server->mutex);
+        if (client != NULL) {  /* could not be served */
+            close(fd);
+            _client_delete(client, config->max_pending);
+        }
+    }
+
+    /* a failure leaves the signal thread waiting, wake it up for nothing */
+    pthread_mutex_lock(&server->mutex);
+    if (!server->stopping) {
+        pthread_kill(signal_thread, SIGTERM);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    pthread_join(signal_thread, NULL);
+
+    const int saved = errno;
+    close(server->listen_fd);
+    unlink(path);
+
+    /* the clients answer what they have read, then leave */
+    pthread_mutex_lock(&server->mutex);
+    while (server->n_clients > 0) {
+        pthread_cond_wait(&server->client_cond, &server->mutex);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    errno = saved;
+    return ret;
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+int server_run(const ServerConfig* config, const char* socket_path,
+               ServerStats* stats)
+{
+    memset(stats, 0, sizeof(ServerStats));
+
+    Server server;
+    memset(&server, 0, sizeof(Server));
+    server.config = config;
+    server.stats = stats;
+    server.n_workers = config->batch.n_threads > 1 ? config->batch.n_threads
+                                                   : 1;
+    server.listen_fd = -1;
+    pthread_mutex_init(&server.mutex, NULL);
+    pthread_cond_init(&server.work_cond, NULL);
+    pthread_cond_init(&server.client_cond, NULL);
+
+    /* the threads inherit the mask: only the signal thread takes them, and
+     * a client that is gone fails its writes instead of killing us */
+    sigset_t set, old_set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    struct sigaction ignore, old_pipe;
+    memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore, &old_pipe);
+    if (socket_path != NULL) {
+        pthread_sigmask(SIG_BLOCK, &set, &old_set);
+    }
+
+    server.workers = (Worker*)calloc(server.n_workers, sizeof(Worker));
+    int ret = server.workers == NULL ? -1 : 0;
+    int n_started = 0;
+    for (int w = 0; w < server.n_workers && ret == 0; ++w) {
+        Worker* worker = &server.workers[w];
+        worker->server = &server;
+        batch_driver_pool_init(&config->batch, &worker->pool);
+        if (pthread_create(&worker->thread, NULL, _worker_main,
+                           worker) != 0)
+        {
+            ret = -1;
+            break;
+        }
+        n_started += 1;
+    }
+
+    if (ret == 0 && socket_path != NULL) {
+        ret = _accept_clients(&server, socket_path);
+    } else if (ret == 0) {
+        Client* client = _client_new(&server, STDIN_FILENO, STDOUT_FILENO,
+                                     0);
+        if (client == NULL) {
+            ret = -1;
+        } else {
+            server.n_clients = 1;
+            stats->n_clients = 1;
+            _serve(client);
+        }
+    }
+    const int saved = errno;
+
+    pthread_mutex_lock(&server.mutex);
+    server.closing = 1;
+    pthread_cond_broadcast(&server.work_cond);
+    pthread_mutex_unlock(&server.mutex);
+    for (int w = 0; w < n_started; ++w) {
+        pthread_join(server.workers[w].thread, NULL);
+    }
+    for (int w = 0; w < server.n_workers && server.workers != NULL; ++w) {
+        batch_pool_release(&server.workers[w].pool);
+    }
+    free(server.workers);
+
+    if (socket_path != NULL) {
+        pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    }
+    sigaction(SIGPIPE, &old_pipe, NULL);
+    pthread_cond_destroy(&server.client_cond);
+    pthread_cond_destroy(&server.work_cond);
+    pthread_mutex_destroy(&server.mutex);
+    errno = saved;
+    return ret;
+}
@@ -0,0 +1,63 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include "batch_driver.h"
+
+/**
+ * How the solve server runs.
+ */
+typedef struct
+{
+    BatchConfig batch;        /* how puzzles are solved, n_threads workers */
+    int max_clients;          /* connections served at once */
+    int max_pending;          /* requests of a connection in flight */
+    int warm_region_n_rows;   /* shape built at start-up, 0: none */
+    int warm_region_n_cols;
+} ServerConfig;
+
+/**
+ * Counters of a server run.
+ */
+typedef struct
+{
+    long n_clients;
+    long n_requests;
+    long n_sat;
+    long n_unsat;
+    long n_unknown;
+    long n_errors;   /* bad requests and solver failures */
+} ServerStats;
+
+/**
+ * Serves puzzles until stopped, with `config->batch.n_threads` workers
+ * (at least one) that each keep a BatchPool for the whole run, so the base
+ * encoding of a shape is built once per worker and its solvers stay warm
+ * from one request (and one client) to the next.
+ *
+ * The protocol is line based. Each request is a one-line sudoku (see
+ * sudoku_reader.h); blank lines and lines starting with '#' are skipped.
+ * Each request gets one answer line, in request order:
+ *
+ *     SAT <solution as a one-line sudoku> [<uniqueness>]
+ *     UNSAT
+ *     UNKNOWN                  (deadline reached)
+ *     ERROR <message>
+ *
+ * the uniqueness word ("unique", "multiple" or "unknown") coming with
+ * `config->batch.check_unique` only. Clients may pipeline: up to
+ * `max_pending` requests of a connection are solved while the earlier
+ * answers are being written, and reading stops beyond that. At most
+ * `max_clients` connections are served, later ones wait to be accepted.
+ *
+ * With `socket_path` the server listens on that UNIX socket (replacing a
+ * stale one) until SIGINT or SIGTERM, then stops reading, answers what was
+ * received and removes the socket. Without it the requests are read from
+ * stdin and answered on stdout until the end of the input.
+ *
+ * Returns 0 on success, -1 if the socket, memory or threads could not be
+ * obtained (errno is set for socket errors).
+ */
+int server_run(const ServerConfig* config, const char* socket_path,
+               ServerStats* stats);
+
+#endif
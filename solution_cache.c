@@ -0,0 +1,564 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "solution_cache.h"
+
+#define CACHE_MAGIC "SDKCACH1"
+#define CACHE_MAGIC_SIZE 8
+#define CACHE_DEFAULT_BUCKETS 16
+
+
+/* Header of a disk record, followed by the canonical puzzle and the
+ * canonical solution (n_cells cells each), padded to 8 bytes. */
+typedef struct
+{
+    uint64_t hash;
+    uint64_t check;          /* of the cells, spots damaged records */
+    uint16_t region_n_rows;
+    uint16_t region_n_cols;
+    uint16_t uniqueness;
+    uint16_t reserved;
+} CacheRecord;
+
+
+struct CacheEntry
+{
+    uint64_t hash;
+    int region_n_rows;
+    int region_n_cols;
+    Uniqueness uniqueness;
+    SudokuCell* cells;       /* canonical puzzle, then its solution */
+
+    CacheEntry* next;        /* in its bucket */
+    CacheEntry* newer;
+    CacheEntry* older;
+};
+
+
+/***** Private functions *****/
+
+static uint64_t _checksum(const SudokuCell* cells, size_t n_cells)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;  /* FNV-1a */
+    for (size_t c = 0; c < n_cells; ++c) {
+        h = (h ^ cells[c]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+
+/* Bytes of a record of `n_cells` cells. */
+static size_t _record_size(size_t n_cells)
+{
+    const size_t size = sizeof(CacheRecord) + 2 * n_cells * sizeof(SudokuCell);
+    return (size + 7) & ~(size_t)7;
+}
+
+
+/* What a cache entry may say about uniqueness. */
+static Uniqueness _known(int uniqueness)
+{
+    return uniqueness == UNIQUENESS_UNIQUE || uniqueness == UNIQUENESS_MULTIPLE
+           ? (Uniqueness)uniqueness : UNIQUENESS_UNKNOWN;
+}
+
+
+static int _compare_slots(const void* a, const void* b)
+{
+    const CacheSlot* x = (const CacheSlot*)a;
+    const CacheSlot* y = (const CacheSlot*)b;
+    if (x->hash != y->hash) {
+        return x->hash < y->hash ? -1 : 1;
+    }
+    return x->offset < y->offset ? -1 : (x->offset > y->offset);
+}
+
+
+/* Returns 1 if `solution` is a full grid that keeps the givens of
+ * `puzzle`. */
+static int _is_solution(const Sudoku* puzzle, const Sudoku* solution)
+{
+    const int n = puzzle->n_values;
+    int* seen = (int*)calloc(n + 1, sizeof(int));
+    if (seen == NULL) {
+        return 0;
+    }
+
+    int ok = 1;
+    for (int c = 0; c < puzzle->n_cells && ok; ++c) {
+        const int v = solution->cells[c];
+        ok = v >= 1 && v <= n
+             && (puzzle->cells[c] == 0 || puzzle->cells[c] == v);
+    }
+
+    /* every row, column and region holds each value once; `seen` holds
+     * the number of the unit a value was last seen in */
+    int unit = 0;
+    for (int u = 0; u < n && ok; ++u) {
+        const int i0 = u / puzzle->region_n_rows * puzzle->region_n_rows;
+        const int j0 = u % puzzle->region_n_rows * puzzle->region_n_cols;
+        for (int kind = 0; kind < 3 && ok; ++kind) {
+            unit += 1;
+            for (int k = 0; k < n && ok; ++k) {
+                int v;
+                if (kind == 0) {
+                    v = sudoku_get(solution, u, k);
+                } else if (kind == 1) {
+                    v = sudoku_get(solution, k, u);
+                } else {
+                    v = sudoku_get(solution, i0 + k / puzzle->region_n_cols,
+                                   j0 + k % puzzle->region_n_cols);
+                }
+                ok = seen[v] != unit;
+                seen[v] = unit;
+            }
+        }
+    }
+
+    free(seen);
+    return ok;
+}
+
+
+static int _same_puzzle(const CacheEntry* entry, const CacheKey* key)
+{
+    const Sudoku* canon = key->canon;
+    return entry->hash == key->hash
+           && entry->region_n_rows == canon->region_n_rows
+           && entry->region_n_cols == canon->region_n_cols
+           && memcmp(entry->cells, canon->cells,
+                     canon->n_cells * sizeof(SudokuCell)) == 0;
+}
+
+
+static void _unlink_recency(SolutionCache* cache, CacheEntry* entry)
+{
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+}
+
+
+static void _push_newest(SolutionCache* cache, CacheEntry* entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if (cache->newest != NULL) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+
+static void _evict_oldest(SolutionCache* cache)
+{
+    CacheEntry* entry = cache->oldest;
+    _unlink_recency(cache, entry);
+
+    CacheEntry** link = &cache->buckets[entry->hash & (cache->n_buckets - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+
+    free(entry->cells);
+    free(entry);
+    cache->n_entries -= 1;
+}
+
+
+static CacheEntry* _find(SolutionCache* cache, const CacheKey* key)
+{
+    CacheEntry* entry = cache->buckets[key->hash & (cache->n_buckets - 1)];
+    while (entry != NULL && !_same_puzzle(entry, key)) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+
+/* Adds a most recently used entry for `key`, with the `n_cells` cells of
+ * `solution`, evicting the least recently used one if the cache is full.
+ * Returns NULL if memory is exhausted. */
+static CacheEntry* _insert(SolutionCache* cache, const CacheKey* key,
+                           const SudokuCell* solution, Uniqueness uniqueness)
+{
+    const int n_cells = key->canon->n_cells;
+    CacheEntry* entry = (CacheEntry*)malloc(sizeof(CacheEntry));
+    SudokuCell* cells = (SudokuCell*)malloc(2 * (size_t)n_cells
+                                            * sizeof(SudokuCell));
+    if (entry == NULL || cells == NULL) {
+        free(entry);
+        free(cells);
+        return NULL;
+    }
+    if (cache->n_entries == cache->capacity) {
+        _evict_oldest(cache);
+    }
+
+    entry->hash = key->hash;
+    entry->region_n_rows = key->canon->region_n_rows;
+    entry->region_n_cols = key->canon->region_n_cols;
+    entry->uniqueness = uniqueness;
+    entry->cells = cells;
+    memcpy(cells, key->canon->cells, n_cells * sizeof(SudokuCell));
+    memcpy(cells + n_cells, solution, n_cells * sizeof(SudokuCell));
+
+    CacheEntry** bucket = &cache->buckets[key->hash & (cache->n_buckets - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    _push_newest(cache, entry);
+    cache->n_entries += 1;
+    return entry;
+}
+
+
+/* Looks `key` up in the disk records, bringing a match into memory. */
+static CacheEntry* _find_on_disk(SolutionCache* cache, const CacheKey* key)
+{
+    size_t lo = 0, hi = cache->n_slots;
+    while (lo < hi) {  /* first slot of the hash */
+        const size_t mid = lo + (hi - lo) / 2;
+        if (cache->slots[mid].hash < key->hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* the last record of the puzzle is the one that knows the most */
+    const Sudoku* canon = key->canon;
+    const size_t cells_size = canon->n_cells * sizeof(SudokuCell);
+    const char* found = NULL;
+    CacheRecord record;
+    for (; lo < cache->n_slots && cache->slots[lo].hash == key->hash; ++lo) {
+        const char* data = cache->map + cache->slots[lo].offset;
+        CacheRecord candidate;
+        memcpy(&candidate, data, sizeof(CacheRecord));
+        if (candidate.region_n_rows == canon->region_n_rows
+            && candidate.region_n_cols == canon->region_n_cols
+            && memcmp(data + sizeof(CacheRecord), canon->cells,
+                      cells_size) == 0)
+        {
+            found = data + sizeof(CacheRecord);
+            record = candidate;
+        }
+    }
+    if (found == NULL) {
+        return NULL;
+    }
+
+    SudokuCell* solution = (SudokuCell*)malloc(cells_size);
+    if (solution == NULL) {
+        return NULL;
+    }
+    memcpy(solution, found + cells_size, cells_size);
+    CacheEntry* entry = _insert(cache, key, solution,
+                                _known(record.uniqueness));
+    free(solution);
+    return entry;
+}
+
+
+static void _append(SolutionCache* cache, const CacheEntry* entry)
+{
+    const size_t n_cells = (size_t)entry->region_n_rows * entry->region_n_cols
+                           * entry->region_n_rows * entry->region_n_cols;
+    const size_t size = _record_size(n_cells);
+    char* data = (char*)calloc(1, size);
+    if (data == NULL) {
+        return;  /* the grid stays in memory only */
+    }
+
+    CacheRecord record;
+    memset(&record, 0, sizeof(CacheRecord));
+    record.hash = entry->hash;
+    record.check = _checksum(entry->cells, 2 * n_cells);
+    record.region_n_rows = (uint16_t)entry->region_n_rows;
+    record.region_n_cols = (uint16_t)entry->region_n_cols;
+    record.uniqueness = (uint16_t)entry->uniqueness;
+    memcpy(data, &record, sizeof(CacheRecord));
+    memcpy(data + sizeof(CacheRecord), entry->cells,
+           2 * n_cells * sizeof(SudokuCell));
+
+    /* one write per record, O_APPEND puts it at the end */
+    ssize_t n_written;
+    do {
+        n_written = write(cache->fd, data, size);
+    } while (n_written < 0 && errno == EINTR);
+    free(data);
+}
+
+
+/* Indexes the records of the mapped file, and cuts off a damaged tail so
+ * that new records can be found after it. */
+static int _load_records(SolutionCache* cache)
+{
+    size_t capacity = 0;
+    size_t offset = CACHE_MAGIC_SIZE;
+    while (offset + sizeof(CacheRecord) <= cache->map_size) {
+        CacheRecord record;
+        memcpy(&record, cache->map + offset, sizeof(CacheRecord));
+        const long long n = (long long)record.region_n_rows
+                            * record.region_n_cols;
+        if (n <= 0 || n > SUDOKU_MAX_VALUES || n * n > INT_MAX) {
+            break;
+        }
+        const size_t n_cells = (size_t)(n * n);
+        const size_t size = _record_size(n_cells);
+        if (size > cache->map_size - offset
+            || _checksum((const SudokuCell*)(cache->map + offset
+                                             + sizeof(CacheRecord)),
+                         2 * n_cells) != record.check)
+        {
+            break;
+        }
+
+        if (cache->n_slots == capacity) {
+            capacity = capacity == 0 ? 64 : 2 * capacity;
+            CacheSlot* slots = (CacheSlot*)realloc(cache->slots,
+                                                   capacity
+                                                   * sizeof(CacheSlot));
+            if (slots == NULL) {
+                return -1;
+            }
+            cache->slots = slots;
+        }
+        cache->slots[cache->n_slots].hash = record.hash;
+        cache->slots[cache->n_slots].offset = offset;
+        cache->n_slots += 1;
+        offset += size;
+    }
+
+    if (offset < cache->map_size && ftruncate(cache->fd, offset) != 0) {
+        return -1;
+    }
+    qsort(cache->slots, cache->n_slots, sizeof(CacheSlot), _compare_slots);
+    return 0;
+}
+
+
+static int _open_file(SolutionCache* cache, const char* path)
+{
+    cache->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    struct stat st;
+    if (cache->fd < 0 || fstat(cache->fd, &st) != 0) {
+        return -1;
+    }
+
+    if (st.st_size == 0) {
+        return write(cache->fd, CACHE_MAGIC, CACHE_MAGIC_SIZE)
+               == CACHE_MAGIC_SIZE ? 0 : -1;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                     cache->fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    cache->map = (const char*)map;
+    cache->map_size = (size_t)st.st_size;
+    if (cache->map_size < CACHE_MAGIC_SIZE
+        || memcmp(cache->map, CACHE_MAGIC, CACHE_MAGIC_SIZE) != 0)
+    {
+        errno = EINVAL;  /* not a cache, better not append to it */
+        return -1;
+    }
+    return _load_records(cache);
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+int solution_cache_open(SolutionCache* cache, int capacity,
+                        const char* path)
+{
+    memset(cache, 0, sizeof(SolutionCache));
+    pthread_mutex_init(&cache->mutex, NULL);
+    cache->fd = -1;
+    cache->capacity = capacity > 0 ? capacity : 1;
+
+    cache->n_buckets = CACHE_DEFAULT_BUCKETS;
+    while (cache->n_buckets < cache->capacity) {
+        cache->n_buckets *= 2;
+    }
+    cache->buckets = (CacheEntry**)calloc(cache->n_buckets,
+                                          sizeof(CacheEntry*));
+    if (cache->buckets == NULL
+        || (path != NULL && _open_file(cache, path) != 0))
+    {
+        const int saved_errno = errno;
+        solution_cache_close(cache);
+        errno = saved_errno;
+        return -1;
+    }
+    return 0;
+}
+
+
+void solution_cache_close(SolutionCache* cache)
+{
+    while (cache->oldest != NULL) {
+        _evict_oldest(cache);
+    }
+    free(cache->buckets);
+    free(cache->slots);
+    if (cache->map != NULL) {
+        munmap((void*)cache->map, cache->map_size);
+    }
+    if (cache->fd >= 0) {
+        close(cache->fd);
+    }
+    pthread_mutex_destroy(&cache->mutex);
+    memset(cache, 0, sizeof(SolutionCache));
+    cache->fd = -1;
+}
+
+
+int cache_key_init(CacheKey* key, const Sudoku* puzzle)
+{
+    key->canon = sudoku_new();
+    if (key->canon == NULL) {
+        return -1;
+    }
+    if (sudoku_init(key->canon, puzzle->region_n_rows,
+                    puzzle->region_n_cols) != NO_ERROR
+        || sudoku_transform_init(&key->transform, puzzle->n_values) != 0)
+    {
+        sudoku_delete(key->canon);
+        key->canon = NULL;
+        return -1;
+    }
+    if (sudoku_canonicalize(puzzle, key->canon, &key->transform,
+                            &key->hash) != 0)
+    {
+        cache_key_release(key);
+        return -1;
+    }
+    return 0;
+}
+
+
+void cache_key_release(CacheKey* key)
+{
+    if (key->canon != NULL) {
+        sudoku_delete(key->canon);
+        key->canon = NULL;
+    }
+    sudoku_transform_release(&key->transform);
+}
+
+
+int solution_cache_get(SolutionCache* cache, const CacheKey* key,
+                       const Sudoku* puzzle, Sudoku* solution,
+                       int need_uniqueness, Uniqueness* uniqueness)
+{
+    /* `solution` may be `puzzle`, the cached grid is checked apart */
+    Sudoku* canon_solution = sudoku_clone(key->canon);
+    Sudoku* grid = sudoku_clone(puzzle);
+    if (canon_solution == NULL || grid == NULL) {
+        if (canon_solution != NULL) {
+            sudoku_delete(canon_solution);
+        }
+        if (grid != NULL) {
+            sudoku_delete(grid);
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    CacheEntry* entry = _find(cache, key);
+    if (entry != NULL) {
+        _unlink_recency(cache, entry);
+        _push_newest(cache, entry);
+    } else if (cache->n_slots > 0) {
+        entry = _find_on_disk(cache, key);
+    }
+    Uniqueness found = UNIQUENESS_UNKNOWN;
+    if (entry != NULL) {
+        memcpy(canon_solution->cells, entry->cells + key->canon->n_cells,
+               key->canon->n_cells * sizeof(SudokuCell));
+        found = entry->uniqueness;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    int hit = 0;
+    if (entry != NULL
+        && (!need_uniqueness || found != UNIQUENESS_UNKNOWN))
+    {
+        sudoku_transform_revert(&key->transform, canon_solution, grid);
+        hit = _is_solution(puzzle, grid);
+    }
+    if (hit) {
+        sudoku_copy_cells(solution, grid);
+        solution->n_fixed_cells = puzzle->n_fixed_cells;
+    }
+    sudoku_delete(canon_solution);
+    sudoku_delete(grid);
+
+    pthread_mutex_lock(&cache->mutex);
+    if (hit) {
+        cache->n_hits += 1;
+    } else {
+        cache->n_misses += 1;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (hit && uniqueness != NULL) {
+        *uniqueness = found;
+    }
+    return hit;
+}
+
+
+void solution_cache_put(SolutionCache* cache, const CacheKey* key,
+                        const Sudoku* solution, Uniqueness uniqueness)
+{
+    Sudoku* canon_solution = sudoku_clone(key->canon);
+    if (canon_solution == NULL) {
+        return;
+    }
+    sudoku_transform_apply(&key->transform, solution, canon_solution);
+    uniqueness = _known(uniqueness);
+
+    pthread_mutex_lock(&cache->mutex);
+    CacheEntry* entry = _find(cache, key);
+    if (entry == NULL && cache->n_slots > 0) {
+        entry = _find_on_disk(cache, key);
+    }
+    if (entry == NULL) {
+        entry = _insert(cache, key, canon_solution->cells, uniqueness);
+        if (entry != NULL && cache->fd >= 0) {
+            _append(cache, entry);
+        }
+    } else if (entry->uniqueness == UNIQUENESS_UNKNOWN
+               && uniqueness != UNIQUENESS_UNKNOWN)
+    {
+        /* a later record of the same puzzle takes precedence on disk */
+        entry->uniqueness = uniqueness;
+        if (cache->fd >= 0) {
+            _append(cache, entry);
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    sudoku_delete(canon_solution);
+}
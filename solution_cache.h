@@ -0,0 +1,109 @@
+#ifndef _SOLUTION_CACHE_H_
+#define _SOLUTION_CACHE_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "canon.h"
+#include "sudoku.h"
+#include "unique.h"
+
+typedef struct CacheEntry CacheEntry;
+
+/* record of the disk cache, by hash */
+typedef struct
+{
+    uint64_t hash;
+    size_t offset;
+} CacheSlot;
+
+/**
+ * Solved grids by the canonical form of their puzzle (see canon.h), so a
+ * puzzle that is a relabeling, transposition or band/stack permutation of
+ * one solved before is answered without encoding nor solving.
+ *
+ * The most recently used `capacity` grids are kept in memory. With a disk
+ * file, every grid solved is also appended to it, and the grids of earlier
+ * runs are read through a read-only mapping of the file as it was opened.
+ * Any number of threads may use the cache at once.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex;
+
+    int capacity;          /* entries kept in memory */
+    int n_entries;
+    int n_buckets;         /* power of two */
+    CacheEntry** buckets;
+    CacheEntry* newest;    /* recency list */
+    CacheEntry* oldest;
+
+    int fd;                /* disk file, -1 without one */
+    const char* map;       /* its contents when opened */
+    size_t map_size;
+    CacheSlot* slots;      /* its records, sorted by hash */
+    size_t n_slots;
+
+    long n_hits;
+    long n_misses;
+} SolutionCache;
+
+/**
+ * Canonical form of a puzzle, what the cache is looked up with.
+ */
+typedef struct
+{
+    Sudoku* canon;
+    SudokuTransform transform;
+    uint64_t hash;
+} CacheKey;
+
+/**
+ * Opens a cache keeping `capacity` grids in memory and, if `path` is not
+ * NULL, backed by the file at `path` (created if needed). A file that is
+ * not a cache is an error. A truncated last record, as left by a crash, is
+ * cut off, so the file is meant for one process at a time.
+ *
+ * Returns 0 on success, -1 on error (errno is set for file errors).
+ */
+int solution_cache_open(SolutionCache* cache, int capacity,
+                        const char* path);
+
+/**
+ *
+ */
+void solution_cache_close(SolutionCache* cache);
+
+/**
+ * Computes the key of `puzzle`. Returns 0 on success, -1 if memory is
+ * exhausted.
+ */
+int cache_key_init(CacheKey* key, const Sudoku* puzzle);
+
+/**
+ *
+ */
+void cache_key_release(CacheKey* key);
+
+/**
+ * Looks `puzzle`, whose key is `key`, up. On a hit its solution is stored
+ * in `solution` (same shape, may be `puzzle`), `uniqueness` (if not NULL)
+ * receives what is known about it (UNIQUENESS_UNKNOWN if it was never
+ * checked, a miss when `need_uniqueness` is set) and 1 is returned, else 0.
+ * A cached grid is only returned after checking that it is a full grid
+ * agreeing with the givens of `puzzle`, so neither a hash collision nor a
+ * damaged file can give a wrong answer.
+ */
+int solution_cache_get(SolutionCache* cache, const CacheKey* key,
+                       const Sudoku* puzzle, Sudoku* solution,
+                       int need_uniqueness, Uniqueness* uniqueness);
+
+/**
+ * Stores `solution` for the puzzle of `key`, in memory and on disk. An
+ * entry that is already there only gets its uniqueness updated.
+ */
+void solution_cache_put(SolutionCache* cache, const CacheKey* key,
+                        const Sudoku* solution, Uniqueness uniqueness);
+
+#endif
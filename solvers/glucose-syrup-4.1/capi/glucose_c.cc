@@ -0,0 +1,113 @@
+/*****************************************************************************************[glucose_c.cc]
+ C interface to Glucose::SimpSolver, modelled after IPASIR.
+ **************************************************************************************************/
+
+#include <stdlib.h>
+
+#include "simp/SimpSolver.h"
+#include "capi/glucose_c.h"
+
+using namespace Glucose;
+
+//=================================================================================================
+// The solver instance handed out to C code.
+
+struct GlucoseSolver : public SimpSolver {
+    vec<Lit>  lits;       // clause under construction
+    vec<Lit>  assumps;    // assumptions for the next solve
+    vec<char> failed;     // failed[v]: assumption on v took part in the final conflict
+
+    GlucoseSolver() {
+        verbosity = -1;           // SimpSolver::eliminate() still reports at verbosity 0
+        adaptStrategies = false;  // adaptSolver() reports on stdout, keep quiet when embedded
+    }
+
+    Lit import(int lit) {
+        int v = abs(lit) - 1;
+        while (v >= nVars()) newVar();
+        return mkLit(v, lit < 0);
+    }
+};
+
+//=================================================================================================
+// C interface:
+
+extern "C" {
+
+const char* glucose_signature(void) { return "glucose-syrup-4.1"; }
+
+GlucoseSolver* glucose_init(void)
+{
+    try {
+        return new GlucoseSolver();
+    } catch (OutOfMemoryException&) {
+        return NULL;
+    }
+}
+
+void glucose_release(GlucoseSolver* s) { delete s; }
+
+void glucose_add(GlucoseSolver* s, int lit)
+{
+    if (lit != 0) {
+        s->lits.push(s->import(lit));
+    } else {
+        s->addClause(s->lits);
+        s->lits.clear();
+    }
+}
+
+void glucose_assume(GlucoseSolver* s, int lit)
+{
+    Lit p = s->import(lit);
+    s->setFrozen(var(p), true);
+    s->assumps.push(p);
+}
+
+void glucose_interrupt(GlucoseSolver* s)
+{
+    s->interrupt();
+}
+
+void glucose_clear_interrupt(GlucoseSolver* s)
+{
+    s->clearInterrupt();
+}
+
+int glucose_solve(GlucoseSolver* s)
+{
+    // Simplify during the first call only; from then on clauses may refer to any frozen variable.
+    lbool ret = s->solveLimited(s->assumps, true, true);
+    s->assumps.clear();
+    s->clearInterrupt();
+
+    s->failed.clear();
+    if (ret == l_False) {
+        s->failed.growTo(s->nVars(), 0);
+        for (int i = 0; i < s->conflict.size(); i++)
+            s->failed[var(s->conflict[i])] = 1;
+    }
+
+    return ret == l_True ? GLUCOSE_SAT : ret == l_False ? GLUCOSE_UNSAT : GLUCOSE_UNKNOWN;
+}
+
+int glucose_val(GlucoseSolver* s, int lit)
+{
+    int v = abs(lit) - 1;
+    if (v >= s->model.size() || s->model[v] == l_Undef) return -lit;
+    bool positive = (s->model[v] == l_True) == (lit > 0);
+    return positive ? lit : -lit;
+}
+
+int glucose_failed(GlucoseSolver* s, int lit)
+{
+    int v = abs(lit) - 1;
+    return v < s->failed.size() && s->failed[v];
+}
+
+void glucose_freeze(GlucoseSolver* s, int v)
+{
+    s->setFrozen(var(s->import(v)), true);
+}
+
+}
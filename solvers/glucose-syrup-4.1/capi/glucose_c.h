@@ -0,0 +1,67 @@
+/*****************************************************************************************[glucose_c.h]
+ C interface to Glucose::SimpSolver, modelled after IPASIR.
+
+ Literals are non-zero integers in DIMACS convention: variable v is the literal v, its negation -v.
+ Variables do not need to be declared, they come into existence the first time they are used.
+
+ Build with "make libr" (or "make libs") in this directory to obtain libglucose.a. Code linking it
+ must also link the C++ runtime (e.g. -lstdc++).
+ **************************************************************************************************/
+
+#ifndef Glucose_glucose_c_h
+#define Glucose_glucose_c_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GLUCOSE_UNKNOWN  0
+#define GLUCOSE_SAT     10
+#define GLUCOSE_UNSAT   20
+
+typedef struct GlucoseSolver GlucoseSolver;
+
+// Name and version of the solver.
+const char*    glucose_signature (void);
+
+// Creates a solver instance, returns NULL if memory is exhausted.
+GlucoseSolver* glucose_init      (void);
+
+// Destroys a solver instance.
+void           glucose_release   (GlucoseSolver* s);
+
+// Adds 'lit' to the clause under construction, 0 adds the clause to the solver.
+void           glucose_add       (GlucoseSolver* s, int lit);
+
+// Assumes 'lit' for the next call to glucose_solve only.
+void           glucose_assume    (GlucoseSolver* s, int lit);
+
+// Solves the formula under the current assumptions, which are then cleared.
+// Returns GLUCOSE_SAT, GLUCOSE_UNSAT or GLUCOSE_UNKNOWN (interrupted / out of budget).
+int            glucose_solve     (GlucoseSolver* s);
+
+// Makes the running glucose_solve (or the next one, if none is running) give up with
+// GLUCOSE_UNKNOWN as soon as possible. Meant to be called from another thread; the request is
+// cleared when glucose_solve returns.
+void           glucose_interrupt (GlucoseSolver* s);
+
+// Drops an interrupt request that came too late for the glucose_solve it was meant for, so
+// that it does not stop the next one.
+void           glucose_clear_interrupt(GlucoseSolver* s);
+
+// After GLUCOSE_SAT: returns 'lit' if it is true in the model, '-lit' if it is false.
+int            glucose_val       (GlucoseSolver* s, int lit);
+
+// After GLUCOSE_UNSAT: returns 1 if assumption 'lit' was used to prove unsatisfiability.
+int            glucose_failed    (GlucoseSolver* s, int lit);
+
+// Protects variable 'var' from variable elimination. Elimination only runs during the first call
+// to glucose_solve; variables that will be used in clauses added after it must be frozen before.
+// Assumed variables are frozen automatically.
+void           glucose_freeze    (GlucoseSolver* s, int var);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
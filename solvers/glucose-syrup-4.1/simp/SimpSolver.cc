@@ -712,7 +712,7 @@ bool SimpSolver::eliminate(bool turn_off_elim)
 
     int toPerform = clauses.size()<=4800000;
     
-    if(!toPerform) {
+    if(!toPerform && verbosity >= 1) {
       printf("c Too many clauses... No preprocessing\n");
     }
 
@@ -1,95 +1,11 @@
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "sudoku.h"
-
-enum ErrorCode {
-    NO_ERROR = 0,
-    ERR_ERRNO,
-    ERR_IO,
-    ERR_EOF,
-    ERR_MEMORY,
-    ERR_NULL_OUTPUT_PARAM,
-    ERR_INVALID_SIZE,
-    ERR_INVALID_HEADER,
-    ERR_INVALID_NUM_CELLS,
-    ERR_INVALID_CELL_VALUE
-};
-
-
-/***** Private functions *****/
-
-static int _parse_sudoku_file_header(FILE* file, int* region_n_rows,
-                                     int* region_n_cols)
-{
-    /* read first non-empty line */
-    char dummy;
-    int n_matches = fscanf(file, "%d %d%[\n\t\r ]",
-                           region_n_rows, region_n_cols, &dummy);
-    if (n_matches == EOF) {
-        return ERR_EOF;
-    } else if (n_matches != 3) {
-        if (ferror(file)) {
-            return ERR_IO;
-        } else if (feof(file)) {
-            return ERR_EOF;
-        }
-        return ERR_INVALID_HEADER;
-    }
-
-    return NO_ERROR;
-}
-
-
-static int _parse_sudoku_file_cells(FILE* file, Sudoku* sudoku)
-{
-    int value = 0;
-    unsigned sudoku_size = sudoku->region_n_rows * sudoku->region_n_cols;
-
-    for (unsigned i = 0; i < sudoku_size; ++i) {
-        for (unsigned j = 0; j < sudoku_size; ++j) {
-            errno = 0;
-            int n_matches = fscanf(file, "%d", &value);
-            if (n_matches == EOF) {
-                return ERR_INVALID_NUM_CELLS;
-            } else if (n_matches != 1) {
-                if (ferror(file)) {
-                    return ERR_IO;
-                } else if (feof(file)) {
-                    return ERR_EOF;
-                }
-                return ERR_INVALID_CELL_VALUE;
-            }
-            sudoku->cells[i][j] = value;
-            if (value > 0) {
-                sudoku->n_fixed_cells += 1;
-            }
-        }
-    }
-
-    return NO_ERROR;
-}
-
-
-int _parse_sudoku_file(FILE* file, Sudoku* sudoku)
-{
-    int region_n_rows, region_n_cols;
-
-    int ret = _parse_sudoku_file_header(file, &region_n_rows, &region_n_cols);
-    if (ret != NO_ERROR) { return ret; }
-
-    ret = sudoku_init(sudoku, region_n_rows, region_n_cols);
-    if (ret != NO_ERROR) { return ret; }
-
-    if (ret == NO_ERROR) {
-        ret = _parse_sudoku_file_cells(file, sudoku);
-    }
-
-    return ret;
-}
-
+#include "sudoku_reader.h"
 
 /****************************/
 /***** Public functions *****/
@@ -122,32 +38,25 @@ int sudoku_init(Sudoku* sudoku, int region_n_rows, int region_n_cols)
 {
     errno = 0;  /* clear error state */
 
-    if (region_n_rows <= 0 || region_n_cols <= 0) {
+    if (region_n_rows <= 0 || region_n_cols <= 0
+        || (long)region_n_rows * region_n_cols > SUDOKU_MAX_VALUES)
+    {
         return ERR_INVALID_SIZE;
     }
-
-    /* allocate rows */
+    /* n_cells is an int, n^2 has to fit in one */
     int sudoku_size = region_n_rows * region_n_cols;
-    sudoku->cells = (int**)malloc(sudoku_size * sizeof(int*));
-    if (sudoku->cells == NULL) {
-        return ERR_MEMORY;
+    if ((long long)sudoku_size * sudoku_size > INT_MAX) {
+        return ERR_INVALID_SIZE;
     }
 
-    /* allocate columns */
-    for (int i = 0; i < sudoku_size; ++i) {
-        sudoku->cells[i] = (int*)malloc(sudoku_size * sizeof(int));
-
-        if (sudoku->cells[i] == NULL) {
-            while (i >= 0) {
-                free(sudoku->cells[i]);
-                sudoku->cells[i--] = NULL;
-            }
-            free(sudoku->cells);
-            return ERR_MEMORY;
-        }
-
-        memset(sudoku->cells[i], 0, sudoku_size * sizeof(int));
+    /* a single block for every cell */
+    SudokuCell* cells = (SudokuCell*)calloc((size_t)sudoku_size * sudoku_size,
+                                            sizeof(SudokuCell));
+    if (cells == NULL) {
+        return ERR_MEMORY;
     }
+    free(sudoku->cells);  /* in case it is being reinitialized */
+    sudoku->cells = cells;
 
     sudoku->n_rows = sudoku_size;
     sudoku->n_cols = sudoku_size;
@@ -161,32 +70,74 @@ int sudoku_init(Sudoku* sudoku, int region_n_rows, int region_n_cols)
 
 void sudoku_delete(Sudoku* sudoku)
 {
-    for (int i = 0; i < sudoku->n_rows; ++i) {
-        free(sudoku->cells[i]);
-    }
     free(sudoku->cells);
     free(sudoku);
 }
 
 
+Sudoku* sudoku_clone(const Sudoku* sudoku)
+{
+    Sudoku* clone = sudoku_new();
+    if (clone == NULL) {
+        return NULL;
+    }
+    if (sudoku_init(clone, sudoku->region_n_rows,
+                    sudoku->region_n_cols) != NO_ERROR)
+    {
+        sudoku_delete(clone);
+        return NULL;
+    }
+    sudoku_copy_cells(clone, sudoku);
+    return clone;
+}
+
+
+void sudoku_copy_cells(Sudoku* dst, const Sudoku* src)
+{
+    memcpy(dst->cells, src->cells, (size_t)src->n_cells * sizeof(SudokuCell));
+    dst->n_fixed_cells = src->n_fixed_cells;
+}
+
+
+void sudoku_reset(Sudoku* sudoku)
+{
+    memset(sudoku->cells, 0, (size_t)sudoku->n_cells * sizeof(SudokuCell));
+    sudoku->n_fixed_cells = 0;
+}
+
+
 int sudoku_parse_file(const char* path, Sudoku* sudoku)
 {
     if (sudoku == NULL) {
         return ERR_NULL_OUTPUT_PARAM;
     }
 
-    FILE* f = fopen(path, "r");
-    if (f == NULL) {
-        return ERR_ERRNO;
+    SudokuReader reader;
+    int ret = sudoku_reader_open(&reader, path);
+    if (ret != NO_ERROR) {
+        return ret;
     }
 
-    int ret = _parse_sudoku_file(f, sudoku);
-    fclose(f);
+    ret = sudoku_reader_next(&reader, sudoku);  /* the first puzzle */
+    sudoku_reader_close(&reader);
 
     return ret;
 }
 
 
+int sudoku_write(FILE* outf, const Sudoku* sudoku)
+{
+    fprintf(outf, "%d %d\n", sudoku->region_n_rows, sudoku->region_n_cols);
+    for (int i = 0; i < sudoku->n_rows; ++i) {
+        for (int j = 0; j < sudoku->n_cols; ++j) {
+            fprintf(outf, j == 0 ? "%d" : " %d", sudoku_get(sudoku, i, j));
+        }
+        fputc('\n', outf);
+    }
+    return ferror(outf) ? ERR_IO : NO_ERROR;
+}
+
+
 const char* sudoku_translate_error_code(int error_code)
 {
     switch (error_code) {
@@ -203,7 +154,8 @@ const char* sudoku_translate_error_code(int error_code)
         case ERR_NULL_OUTPUT_PARAM:
             return "Expected output parameter cannot be NULL";
         case ERR_INVALID_SIZE:
-            return "Invalid size, some dimension is less than or equal to 0";
+            return "Invalid size, some dimension is less than or equal to 0 "
+                "or the grid is too big";
         case ERR_INVALID_HEADER:
             return "Invalid sudoku file header.\n"
                 "It must be a line with format: <num_rows> <num_cols>";
@@ -211,6 +163,9 @@ const char* sudoku_translate_error_code(int error_code)
             return "Number of rows/cols does not match the header";
         case ERR_INVALID_CELL_VALUE:
             return "One or more cells contain an invalid value";
+        case ERR_INVALID_LINE:
+            return "Invalid one-line sudoku, it must have n^2 cells for a "
+                "grid of n values";
         default:
             return "Unkown error (This should not happen)";
     }
@@ -260,10 +215,11 @@ void sudoku_print(FILE* outf, const Sudoku* sudoku)
             }
 
             // cell value
-            if (sudoku->cells[i][j] == 0) {
+            const int value = sudoku_get(sudoku, i, j);
+            if (value == 0) {
                 fprintf(outf, "%*c", n_digits, ' ');
             } else {
-                fprintf(outf, "%*d", n_digits, sudoku->cells[i][j]);
+                fprintf(outf, "%*d", n_digits, value);
             }
 
             fputs(" ", outf);
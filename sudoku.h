@@ -2,8 +2,16 @@
 #ifndef _SUDOKU_IO_H_
 #define _SUDOKU_IO_H_
 
+#include <stdint.h>
 #include <stdio.h>
 
+/**
+ * Content of a cell: 0 when empty, otherwise its value in 1..n_values.
+ */
+typedef uint16_t SudokuCell;
+
+/* biggest grid a SudokuCell can describe */
+#define SUDOKU_MAX_VALUES UINT16_MAX
 
 /**
  *
@@ -20,10 +28,26 @@ typedef struct
 
     int n_fixed_cells;
 
-    int **cells;
+    SudokuCell* cells;  /* n_rows * n_cols cells, row after row */
 } Sudoku;
 
-enum ErrorCode;
+/**
+ * Error codes of the functions that load sudokus, see
+ * sudoku_translate_error_code.
+ */
+enum ErrorCode {
+    NO_ERROR = 0,
+    ERR_ERRNO,
+    ERR_IO,
+    ERR_EOF,
+    ERR_MEMORY,
+    ERR_NULL_OUTPUT_PARAM,
+    ERR_INVALID_SIZE,
+    ERR_INVALID_HEADER,
+    ERR_INVALID_NUM_CELLS,
+    ERR_INVALID_CELL_VALUE,
+    ERR_INVALID_LINE,
+};
 
 /**
  *
@@ -33,7 +57,7 @@ Sudoku* sudoku_new();
 /**
  *
  */
-int sudoku_init(Sudoku*, int region_n_cols, int region_n_rows);
+int sudoku_init(Sudoku*, int region_n_rows, int region_n_cols);
 
 /**
  *
@@ -41,10 +65,61 @@ int sudoku_init(Sudoku*, int region_n_cols, int region_n_rows);
 void sudoku_delete(Sudoku* sudoku);
 
 /**
- *
+ * Returns a new sudoku with the shape and cells of `sudoku`, or NULL if
+ * memory could not be allocated.
+ */
+Sudoku* sudoku_clone(const Sudoku* sudoku);
+
+/**
+ * Copies the cells of `src` into `dst`, which must have the same shape.
+ */
+void sudoku_copy_cells(Sudoku* dst, const Sudoku* src);
+
+/**
+ * Empties every cell of `sudoku`, keeping its shape.
+ */
+void sudoku_reset(Sudoku* sudoku);
+
+/**
+ * Value of the cell at row `i` and column `j`, 0 if it is empty.
+ */
+static inline int sudoku_get(const Sudoku* sudoku, int i, int j)
+{
+    return sudoku->cells[i * sudoku->n_cols + j];
+}
+
+/**
+ * Sets the cell at row `i` and column `j` to `value` (0 empties it).
+ * `n_fixed_cells` is not updated.
+ */
+static inline void sudoku_set(Sudoku* sudoku, int i, int j, int value)
+{
+    sudoku->cells[i * sudoku->n_cols + j] = (SudokuCell)value;
+}
+
+/**
+ * Region of the cell at row `i` and column `j`, regions being numbered
+ * from 0 left to right and top to bottom.
+ */
+static inline int sudoku_region(const Sudoku* sudoku, int i, int j)
+{
+    return (i / sudoku->region_n_rows)
+           * (sudoku->n_values / sudoku->region_n_cols)
+         + j / sudoku->region_n_cols;
+}
+
+/**
+ * Loads the first puzzle of the file at `path`, in any of the formats
+ * described in sudoku_reader.h.
  */
 int sudoku_parse_file(const char* path, Sudoku* sudoku);
 
+/**
+ * Writes `sudoku` as an `.sdk` block, header line included, that
+ * sudoku_parse_file reads back. Returns NO_ERROR or ERR_IO.
+ */
+int sudoku_write(FILE* outf, const Sudoku* sudoku);
+
 /**
  *
  */
@@ -0,0 +1,364 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sudoku_reader.h"
+
+/* one-line sudokus write values with '1'..'9' and then 'A'..'Z' */
+#define LINE_MAX_VALUES 35
+
+#define READ_CHUNK_SIZE (1024 * 1024)
+
+
+/***** Private functions *****/
+
+/* Reads the whole of `fd` into memory, for files that cannot be mapped. */
+static int _read_all(SudokuReader* reader, int fd)
+{
+    size_t capacity = 0;
+    char* data = NULL;
+    for (;;) {
+        if (reader->size == capacity) {
+            capacity += READ_CHUNK_SIZE;
+            char* grown = (char*)realloc(data, capacity);
+            if (grown == NULL) {
+                free(data);
+                return ERR_MEMORY;
+            }
+            data = grown;
+        }
+
+        ssize_t n_read = read(fd, data + reader->size,
+                              capacity - reader->size);
+        if (n_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(data);
+            return ERR_ERRNO;
+        } else if (n_read == 0) {
+            break;
+        }
+        reader->size += (size_t)n_read;
+    }
+
+    reader->data = data;
+    return NO_ERROR;
+}
+
+
+static int _is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+static void _skip_blanks(SudokuReader* reader)
+{
+    while (reader->pos < reader->size && _is_blank(reader->data[reader->pos])) {
+        reader->pos += 1;
+    }
+}
+
+
+/* Skips blanks and newlines. */
+static void _skip_space(SudokuReader* reader)
+{
+    while (reader->pos < reader->size) {
+        const char c = reader->data[reader->pos];
+        if (c == '\n') {
+            reader->line += 1;
+        } else if (!_is_blank(c)) {
+            break;
+        }
+        reader->pos += 1;
+    }
+}
+
+
+/* Moves past the end of the current line. */
+static void _skip_line(SudokuReader* reader)
+{
+    const char* nl = memchr(reader->data + reader->pos, '\n',
+                            reader->size - reader->pos);
+    if (nl == NULL) {
+        reader->pos = reader->size;
+    } else {
+        reader->pos = (size_t)(nl - reader->data) + 1;
+        reader->line += 1;
+    }
+}
+
+
+/* Scans a non negative decimal number. Returns 0 if there are no digits at
+ * the current position. Numbers too big for any grid saturate. */
+static int _scan_int(SudokuReader* reader, int* value)
+{
+    const size_t start = reader->pos;
+    int v = 0;
+    while (reader->pos < reader->size) {
+        const unsigned digit = (unsigned char)reader->data[reader->pos] - '0';
+        if (digit > 9) {
+            break;
+        }
+        if (v <= SUDOKU_MAX_VALUES) {
+            v = v * 10 + (int)digit;
+        }
+        reader->pos += 1;
+    }
+    *value = v;
+    return reader->pos > start;
+}
+
+
+/* Cell value of a one-line sudoku character, -1 if it is not one. */
+static int _line_value(char c)
+{
+    if (c == '.' || c == '0') {
+        return 0;
+    } else if (c >= '1' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'A' && c <= 'Z') {
+        return c - 'A' + 10;
+    } else if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+
+/* Gives `sudoku` the requested shape with every cell empty, reusing its
+ * cells when the shape does not change. */
+static int _prepare(Sudoku* sudoku, int region_n_rows, int region_n_cols)
+{
+    if (sudoku->cells != NULL && sudoku->region_n_rows == region_n_rows
+        && sudoku->region_n_cols == region_n_cols)
+    {
+        sudoku_reset(sudoku);
+        return NO_ERROR;
+    }
+    return sudoku_init(sudoku, region_n_rows, region_n_cols);
+}
+
+
+/* Parses the ".sdk" header at the current position, if there is one: two
+ * numbers and nothing else on the line. Otherwise the position is left
+ * untouched. */
+static int _scan_header(SudokuReader* reader, int* region_n_rows,
+                        int* region_n_cols)
+{
+    const size_t start = reader->pos;
+    if (_scan_int(reader, region_n_rows)
+        && reader->pos < reader->size && _is_blank(reader->data[reader->pos]))
+    {
+        _skip_blanks(reader);
+        if (_scan_int(reader, region_n_cols)) {
+            _skip_blanks(reader);
+            if (reader->pos == reader->size
+                || reader->data[reader->pos] == '\n')
+            {
+                return 1;
+            }
+        }
+    }
+    reader->pos = start;
+    return 0;
+}
+
+
+static int _parse_sdk(SudokuReader* reader, Sudoku* sudoku,
+                      int region_n_rows, int region_n_cols)
+{
+    int ret = _prepare(sudoku, region_n_rows, region_n_cols);
+    if (ret != NO_ERROR) {
+        return ret;
+    }
+
+    SudokuCell* cells = sudoku->cells;
+    for (int c = 0; c < sudoku->n_cells; ++c) {
+        _skip_space(reader);
+        int value;
+        if (!_scan_int(reader, &value)) {
+            return reader->pos == reader->size ? ERR_INVALID_NUM_CELLS
+                                               : ERR_INVALID_CELL_VALUE;
+        } else if (value > sudoku->n_values) {
+            return ERR_INVALID_CELL_VALUE;
+        }
+        cells[c] = (SudokuCell)value;
+        sudoku->n_fixed_cells += value > 0;
+    }
+    return NO_ERROR;
+}
+
+
+static int _parse_line(SudokuReader* reader, Sudoku* sudoku)
+{
+    const char* text = reader->data + reader->pos;
+    size_t len = 0;
+    while (reader->pos + len < reader->size && text[len] != '\n'
+           && !_is_blank(text[len]))
+    {
+        len += 1;
+    }
+
+    /* n * n cells, with only blanks behind */
+    reader->pos += len;
+    _skip_blanks(reader);
+    if (reader->pos < reader->size && reader->data[reader->pos] != '\n') {
+        return ERR_INVALID_LINE;
+    }
+    int n = 1;
+    while ((size_t)(n + 1) * (n + 1) <= len) {
+        n += 1;
+    }
+    if ((size_t)n * n != len || n > LINE_MAX_VALUES) {
+        return ERR_INVALID_LINE;
+    }
+
+    /* regions as square as possible */
+    int region_n_rows = 1;
+    for (int r = 1; r * r <= n; ++r) {
+        if (n % r == 0) {
+            region_n_rows = r;
+        }
+    }
+    int ret = _prepare(sudoku, region_n_rows, n / region_n_rows);
+    if (ret != NO_ERROR) {
+        return ret;
+    }
+
+    SudokuCell* cells = sudoku->cells;
+    for (size_t c = 0; c < len; ++c) {
+        const int value = _line_value(text[c]);
+        if (value < 0 || value > n) {
+            return ERR_INVALID_CELL_VALUE;
+        }
+        cells[c] = (SudokuCell)value;
+        sudoku->n_fixed_cells += value > 0;
+    }
+    return NO_ERROR;
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+int sudoku_reader_open(SudokuReader* reader, const char* path)
+{
+    memset(reader, 0, sizeof(SudokuReader));
+    reader->line = 1;
+
+    errno = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ERR_ERRNO;
+    }
+
+    /* empty or special files (pipes, /proc) are read instead */
+    int ret = NO_ERROR;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                          fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+            reader->data = (const char*)data;
+            reader->size = (size_t)st.st_size;
+            reader->mapped = 1;
+        }
+    }
+    if (!reader->mapped) {
+        ret = _read_all(reader, fd);
+    }
+
+    close(fd);  /* the mapping outlives the descriptor */
+    return ret;
+}
+
+
+int sudoku_reader_next(SudokuReader* reader, Sudoku* sudoku)
+{
+    if (sudoku == NULL) {
+        return ERR_NULL_OUTPUT_PARAM;
+    }
+
+    /* first line with contents */
+    for (;;) {
+        _skip_blanks(reader);
+        if (reader->pos == reader->size) {
+            return ERR_EOF;
+        }
+        const char c = reader->data[reader->pos];
+        if (c == '\n') {
+            reader->pos += 1;
+            reader->line += 1;
+        } else if (c == '#') {
+            _skip_line(reader);
+        } else {
+            break;
+        }
+    }
+    reader->record_line = reader->line;
+
+    int region_n_rows, region_n_cols;
+    if (_scan_header(reader, &region_n_rows, &region_n_cols)) {
+        int ret = _parse_sdk(reader, sudoku, region_n_rows, region_n_cols);
+        if (ret != NO_ERROR) {
+            reader->pos = reader->size;  /* no way to resynchronize */
+        }
+        return ret;
+    }
+
+    int ret = _parse_line(reader, sudoku);
+    _skip_line(reader);
+    return ret;
+}
+
+
+void sudoku_reader_close(SudokuReader* reader)
+{
+    if (reader->mapped) {
+        munmap((void*)reader->data, reader->size);
+    } else {
+        free((void*)reader->data);
+    }
+    reader->data = NULL;
+    reader->size = 0;
+    reader->pos = 0;
+}
+
+
+int sudoku_parse_line(const char* text, size_t len, Sudoku* sudoku)
+{
+    if (sudoku == NULL) {
+        return ERR_NULL_OUTPUT_PARAM;
+    }
+
+    SudokuReader reader;
+    memset(&reader, 0, sizeof(SudokuReader));
+    reader.data = text;
+    reader.size = len;
+    reader.line = 1;
+    return _parse_line(&reader, sudoku);
+}
+
+
+int sudoku_format_line(const Sudoku* sudoku, char* text)
+{
+    if (sudoku->n_values > LINE_MAX_VALUES) {
+        return -1;
+    }
+    for (int c = 0; c < sudoku->n_cells; ++c) {
+        const int value = sudoku->cells[c];
+        text[c] = value == 0 ? '.'
+                  : value <= 9 ? (char)('0' + value)
+                  : (char)('A' + value - 10);
+    }
+    return sudoku->n_cells;
+}
@@ -0,0 +1,74 @@
+#ifndef _SUDOKU_READER_H_
+#define _SUDOKU_READER_H_
+
+#include <stddef.h>
+
+#include "sudoku.h"
+
+/**
+ * Reads the sudokus of a file one after the other. The file is mapped in
+ * memory (or read at once when it cannot be mapped, e.g. a pipe) and
+ * scanned by hand, so big datasets cost no per-puzzle open nor scanf.
+ *
+ * Two record formats are accepted, and may be mixed in a file:
+ *
+ *  - `.sdk` blocks: a "<region_n_rows> <region_n_cols>" header line
+ *    followed by the n * n cell values, separated by blanks (0: empty).
+ *
+ *  - one-line sudokus: the n * n cells of a puzzle in a single line,
+ *    with no blanks in between. '.' and '0' are empty cells, '1'..'9'
+ *    are values 1 to 9 and letters (any case) follow with 10, 11... so
+ *    grids up to 35 values can be written. Regions are as square as
+ *    possible: n = 9 gives 3x3, n = 6 gives 2 rows by 3 columns.
+ *
+ * Blank lines and lines starting with '#' are skipped.
+ */
+typedef struct
+{
+    const char* data;
+    size_t size;
+    size_t pos;
+
+    int mapped;   /* `data` comes from mmap, otherwise from malloc */
+    long line;    /* line number of `pos`, starting at 1 */
+    long record_line;  /* line where the last puzzle returned started */
+} SudokuReader;
+
+/**
+ * Opens the file at `path` for reading. Returns NO_ERROR or an error code
+ * of sudoku.h (ERR_ERRNO if the file cannot be opened).
+ */
+int sudoku_reader_open(SudokuReader* reader, const char* path);
+
+/**
+ * Loads the next puzzle of the file into `sudoku`, which is reinitialized
+ * only if its shape changes. Returns NO_ERROR, ERR_EOF once there are no
+ * more puzzles, or another error code of sudoku.h.
+ *
+ * An invalid one-line sudoku only spoils its own line, reading can go on
+ * with the next one. Errors within an `.sdk` block leave no way to tell
+ * where the next puzzle starts, so the rest of the file is skipped.
+ */
+int sudoku_reader_next(SudokuReader* reader, Sudoku* sudoku);
+
+/**
+ * Releases the file of `reader`.
+ */
+void sudoku_reader_close(SudokuReader* reader);
+
+/**
+ * Loads the one-line sudoku in the `len` characters of `text` (no newline,
+ * blanks allowed at the end) into `sudoku`, as sudoku_reader_next would.
+ * Returns NO_ERROR or an error code of sudoku.h.
+ */
+int sudoku_parse_line(const char* text, size_t len, Sudoku* sudoku);
+
+/**
+ * Writes the cells of `sudoku` into `text` (`n_cells` characters) in the
+ * one-line format, empty cells as '.', without a terminating NUL. Returns
+ * the number of characters written, or -1 if the grid has more values
+ * than the format can write.
+ */
+int sudoku_format_line(const Sudoku* sudoku, char* text);
+
+#endif
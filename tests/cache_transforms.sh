@@ -0,0 +1,100 @@
+#!/bin/sh
+# A puzzle equivalent to a solved one (relabelled, transposed, with its
+# bands and rows permuted) is answered from the cache, and the solution
+# mapped back through the symmetry satisfies the copy's own givens.
+#
+# usage: tests/cache_transforms.sh [<sudoku>]
+
+SUDOKU=./sudoku
+PUZZLE=${1:-examples/sudoku3x3.sdk}
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+fail() {
+    echo "FAIL: $1"
+    exit 1
+}
+
+# .sdk file (values up to 9) as a one-line sudoku
+line() {
+    awk 'NR > 1 { for (i = 1; i <= NF; i++) printf "%s", $i == 0 ? "." : $i }
+         END { print "" }' "$1"
+}
+
+# one-line 9x9 sudoku on stdin through a symmetry: relabel, transpose or
+# permute (bands 0 and 2 swapped, the rows of band 1 rotated)
+transform() {
+    awk -v how="$1" '{
+        split("371958246", label, "")
+        split("789564123", row, "")   # new row r holds old row row[r]
+        for (r = 0; r < 9; r++) {
+            for (c = 0; c < 9; c++) {
+                if (how == "transpose") {
+                    v = substr($0, c * 9 + r + 1, 1)
+                } else if (how == "permute") {
+                    v = substr($0, (row[r + 1] - 1) * 9 + c + 1, 1)
+                } else {
+                    v = substr($0, r * 9 + c + 1, 1)
+                    if (v != ".") {
+                        v = label[v]
+                    }
+                }
+                printf "%s", v
+            }
+        }
+        print ""
+    }'
+}
+
+# batch output of a one-line 9x9 sudoku file: the stage and the grid of its
+# record number `n`, as "<stage> <81 digits>"
+record() {
+    awk -v n="$1" '
+        /^[^|+]*:[0-9]+: / { k++; if (k == n) { stage = $3; take = 1 }
+                              else take = 0; next }
+        take && /^\|/ { gsub(/[^0-9]/, ""); grid = grid $0 }
+        END { print stage, grid }' "$2"
+}
+
+# checks that `grid` solves the one-line `puzzle`
+solves() {
+    awk -v puzzle="$1" -v grid="$2" 'BEGIN {
+        if (length(grid) != 81) exit 1
+        for (p = 0; p < 81; p++) {
+            g = substr(puzzle, p + 1, 1)
+            v = substr(grid, p + 1, 1)
+            r = int(p / 9); c = p % 9; b = int(r / 3) * 3 + int(c / 3)
+            if (v < 1 || (g != "." && g != v) || seen["r" r v]++ ||
+                seen["c" c v]++ || seen["b" b v]++)
+                exit 1
+        }
+    }'
+}
+
+puzzle=$(line "$PUZZLE")
+for how in relabel transpose permute; do
+    copy=$(echo "$puzzle" | transform $how)
+    [ "$copy" != "$puzzle" ] || fail "$how left the puzzle as it was"
+    printf '%s\n%s\n' "$puzzle" "$copy" > "$tmp/requests"
+    "$SUDOKU" -B -K 16 "$tmp/requests" > "$tmp/out" 2>&1 \
+        || fail "$how: batch run"
+    set -- $(record 2 "$tmp/out")
+    [ "$1" = "[cache]" ] || fail "$how: no cache hit ($1)"
+    solves "$copy" "$2" || fail "$how: the cached answer does not solve it"
+done
+
+# every symmetry at once, through the cache file of an earlier run
+copy=$(echo "$puzzle" | transform transpose | transform permute \
+       | transform relabel)
+echo "$puzzle" > "$tmp/first"
+echo "$copy" > "$tmp/second"
+"$SUDOKU" -B -C "$tmp/cache" "$tmp/first" > /dev/null 2>&1 \
+    || fail "run filling the cache file"
+"$SUDOKU" -B -C "$tmp/cache" "$tmp/second" > "$tmp/out" 2>&1 \
+    || fail "run reading the cache file"
+set -- $(record 1 "$tmp/out")
+[ "$1" = "[cache]" ] || fail "combined: no hit from the cache file ($1)"
+solves "$copy" "$2" || fail "combined: the cached answer does not solve it"
+
+echo "PASS"
@@ -0,0 +1,33 @@
+#!/bin/sh
+# A solver that says SATISFIABLE without printing a model must not win a
+# race: the other solver's answer is the one reported.
+#
+# usage: tests/race_no_model.sh [<sudoku> [<picosat>]]
+
+SUDOKU=./sudoku
+PUZZLE=${1:-examples/sudoku3x3.sdk}
+PICOSAT=${2:-solvers/picosat-965/picosat}
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+printf '#!/bin/sh\necho "s SATISFIABLE"\n' > "$tmp/no_model"
+chmod +x "$tmp/no_model"
+
+fail() {
+    echo "FAIL: $1"
+    exit 1
+}
+
+"$SUDOKU" -b external -c "$PICOSAT" "$PUZZLE" | sed -n '/^Finished by/,$p' \
+    > "$tmp/expected"
+grep -q '^Finished by: SAT' "$tmp/expected" || fail "$PICOSAT alone"
+
+"$SUDOKU" -b external -c "$tmp/no_model" -c "$PICOSAT" "$PUZZLE" \
+    | sed -n '/^Finished by/,$p' > "$tmp/raced"
+cmp -s "$tmp/expected" "$tmp/raced" || fail "race won without a model"
+
+"$SUDOKU" -b external -c "$tmp/no_model" "$PUZZLE" | grep -q 'Finished by' \
+    && fail "SAT reported without a model"
+
+echo "PASS"
@@ -0,0 +1,49 @@
+#!/bin/sh
+# The server answers every request line with one line, in request order,
+# even when several workers solve the pipelined requests out of order.
+#
+# usage: tests/server_stdin.sh
+
+SUDOKU=./sudoku
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+fail() {
+    echo "FAIL: $1"
+    exit 1
+}
+
+# .sdk file (values up to 9) as a one-line sudoku
+line() {
+    awk 'NR > 1 { for (i = 1; i <= NF; i++) printf "%s", $i == 0 ? "." : $i }
+         END { print "" }' "$1"
+}
+sat=$(line examples/sudoku3x3.sdk)
+unsat=$(line examples/sudoku3x3_unsat.sdk)
+
+{
+    echo "$sat"
+    echo "# comment"
+    echo
+    echo "not a sudoku"
+    echo "$unsat"
+    echo "................"
+} | "$SUDOKU" -D - -u 2> /dev/null \
+    | awk '{ print $1 ($1 == "SAT" ? " " $3 : "") }' > "$tmp/answers"
+printf 'SAT unique\nERROR\nUNSAT\nSAT multiple\n' > "$tmp/expected"
+cmp -s "$tmp/expected" "$tmp/answers" || fail "answers to a mixed stream"
+
+: > "$tmp/requests"
+: > "$tmp/expected"
+i=0
+while [ $i -lt 50 ]; do
+    printf '%s\n%s\n' "$sat" "$unsat" >> "$tmp/requests"
+    printf 'SAT\nUNSAT\n' >> "$tmp/expected"
+    i=$((i + 1))
+done
+"$SUDOKU" -D - -j 4 -Q 3 < "$tmp/requests" 2> /dev/null \
+    | cut -d ' ' -f 1 > "$tmp/answers"
+cmp -s "$tmp/expected" "$tmp/answers" || fail "pipelined answers out of order"
+
+echo "PASS"
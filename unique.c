@@ -0,0 +1,158 @@
+#include <stdlib.h>
+
+#include "unique.h"
+
+
+/* Stores in `lits` the clause ruling `solution` out, one literal per cell
+ * left empty in `puzzle`: some of them must take another value. Returns the
+ * number of literals, 0 if the puzzle has no empty cells. */
+static int _blocking_literals(const Sudoku* puzzle, const Sudoku* solution,
+                              const VarMap* map, int* lits)
+{
+    const int n = puzzle->n_values;
+    int n_lits = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if (sudoku_get(puzzle, i, j) > 0) {
+                continue;
+            }
+            const int k = sudoku_get(solution, i, j) - 1;
+            lits[n_lits++] = map != NULL ? -var_map_var(map, solution, i, j, k)
+                                         : -x(solution, i, j, k);
+        }
+    }
+    return n_lits;
+}
+
+
+/****************************/
+/***** Public functions *****/
+/****************************/
+
+
+Uniqueness sudoku_check_unique(IncSolver* solver, const Sudoku* puzzle,
+                               const Sudoku* solution, const VarMap* map,
+                               const int* assumptions, int n_assumptions,
+                               const Deadline* deadline)
+{
+    int* lits = (int*)malloc(puzzle->n_cells * sizeof(int));
+    if (lits == NULL) {
+        return UNIQUENESS_ERR_MEMORY;
+    }
+
+    const int n_lits = _blocking_literals(puzzle, solution, map, lits);
+    if (n_lits == 0) {  /* nothing left to choose */
+        free(lits);
+        return UNIQUENESS_UNIQUE;
+    }
+
+    /* the clause goes in before the assumptions, adding resets them */
+    const int guard = inc_solver_new_guard(solver);
+    inc_solver_add_guarded(solver, guard, lits, n_lits);
+    free(lits);
+
+    inc_solver_assume(solver, guard);
+    for (int a = 0; a < n_assumptions; ++a) {
+        inc_solver_assume(solver, assumptions[a]);
+    }
+    RunSolverCode code = inc_solver_solve(solver, NULL, 0, deadline);
+    inc_solver_retire_guard(solver, guard);
+
+    switch (code) {
+        case RUN_SOLVER_SAT:
+            return UNIQUENESS_MULTIPLE;
+        case RUN_SOLVER_UNSAT:
+            return UNIQUENESS_UNIQUE;
+        case RUN_SOLVER_ERR_MEMORY:
+            return UNIQUENESS_ERR_MEMORY;
+        default:
+            return UNIQUENESS_UNKNOWN;
+    }
+}
+
+
+RunSolverCode sudoku_enumerate(IncSolver* solver, const Sudoku* puzzle,
+                               const VarMap* map, const int* assumptions,
+                               int n_assumptions, long limit,
+                               long* n_solutions, SolutionReport report,
+                               void* data, const Deadline* deadline)
+{
+    const int n_vars = map != NULL ? map->n_vars
+                                   : sudoku_encode_num_vars(puzzle);
+    int* model = (int*)malloc((n_vars + 1) * sizeof(int));
+    int* lits = (int*)malloc(puzzle->n_cells * sizeof(int));
+    Sudoku* solution = sudoku_clone(puzzle);
+    if (model == NULL || lits == NULL || solution == NULL) {
+        free(model);
+        free(lits);
+        if (solution != NULL) {
+            sudoku_delete(solution);
+        }
+        return RUN_SOLVER_ERR_MEMORY;
+    }
+
+    /* every blocking clause hangs on the same guard */
+    const int guard = inc_solver_new_guard(solver);
+    long count = 0;
+    RunSolverCode code;
+    for (;;) {
+        inc_solver_assume(solver, guard);
+        for (int a = 0; a < n_assumptions; ++a) {
+            inc_solver_assume(solver, assumptions[a]);
+        }
+        code = inc_solver_solve(solver, model, n_vars, deadline);
+        if (code != RUN_SOLVER_SAT) {
+            break;
+        }
+
+        sudoku_copy_cells(solution, puzzle);
+        if (map != NULL && map->first != NULL) {
+            sudoku_decode_pruned(solution, map, model);
+        } else {
+            sudoku_decode_model(solution, model);
+        }
+        count += 1;
+        if ((report != NULL && report(solution, count, data) != 0)
+            || count >= limit)
+        {
+            break;
+        }
+
+        const int n_lits = _blocking_literals(puzzle, solution, map, lits);
+        if (n_lits == 0) {  /* a full grid has no other solution */
+            break;
+        }
+        inc_solver_add_guarded(solver, guard, lits, n_lits);
+    }
+    inc_solver_retire_guard(solver, guard);
+
+    if (n_solutions != NULL) {
+        *n_solutions = count;
+    }
+    free(model);
+    free(lits);
+    sudoku_delete(solution);
+
+    if (count > 0) {
+        return RUN_SOLVER_SAT;
+    }
+    return code;
+}
+
+
+const char* uniqueness_name(Uniqueness uniqueness)
+{
+    switch (uniqueness) {
+        case UNIQUENESS_NONE:
+            return "none";
+        case UNIQUENESS_UNIQUE:
+            return "unique";
+        case UNIQUENESS_MULTIPLE:
+            return "multiple";
+        case UNIQUENESS_UNKNOWN:
+            return "unknown";
+        case UNIQUENESS_ERR_MEMORY:
+            return "out of memory";
+    }
+    return "?";
+}
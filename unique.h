@@ -0,0 +1,70 @@
+#ifndef _UNIQUE_H_
+#define _UNIQUE_H_
+
+#include "deadline.h"
+#include "encoder.h"
+#include "inc_solver.h"
+#include "sudoku.h"
+
+typedef enum {
+    UNIQUENESS_NONE,       /* the puzzle has no solution at all */
+    UNIQUENESS_UNIQUE,     /* exactly one solution */
+    UNIQUENESS_MULTIPLE,   /* at least two solutions */
+    UNIQUENESS_UNKNOWN,    /* the deadline was over before telling */
+    UNIQUENESS_ERR_MEMORY,
+} Uniqueness;
+
+/**
+ * Tells whether `solution`, found by `solver` for `puzzle` under the
+ * `n_assumptions` literals of `assumptions`, is the only one. A blocking
+ * clause ruling `solution` out is added over the cells that are empty in
+ * `puzzle`, and the same solver is asked again under the same assumptions:
+ * no re-encoding, and everything learnt by the first call is reused.
+ *
+ * The blocking clause hangs on a guard literal that is retired afterwards,
+ * so `solver` stays usable for other puzzles of the same shape. `map`
+ * gives the cell variables of a pruned encoding, NULL means the full
+ * x(i, j, k) layout. Cell variables must survive
+ * preprocessing, see inc_solver_freeze.
+ */
+Uniqueness sudoku_check_unique(IncSolver* solver, const Sudoku* puzzle,
+                               const Sudoku* solution, const VarMap* map,
+                               const int* assumptions, int n_assumptions,
+                               const Deadline* deadline);
+
+/**
+ * Called with each solution found by sudoku_enumerate, numbered from 1.
+ * Returning non zero stops the enumeration.
+ */
+typedef int (*SolutionReport)(const Sudoku* solution, long index,
+                              void* data);
+
+/**
+ * Enumerates the solutions of `puzzle`, encoded in `solver` (with the
+ * variables of `map` if not NULL, see sudoku_check_unique), under the
+ * `n_assumptions` literals of `assumptions`. After each model a clause
+ * blocking its values on the empty cells of `puzzle` is added, so
+ * auxiliary variables of the encoding never yield the same grid twice.
+ * Every solution is passed to `report` (if not NULL) as a full grid.
+ *
+ * The search stops after `limit` solutions, when there are no more, or
+ * once `deadline` is over. If `n_solutions` is not NULL it receives the
+ * number of solutions found (a lower bound if the deadline stopped it).
+ * The blocking clauses are retired afterwards.
+ *
+ * Returns RUN_SOLVER_SAT if there is at least one solution,
+ * RUN_SOLVER_UNSAT if there is none, RUN_SOLVER_UNKNOWN if the deadline
+ * was over before finding one, or an error code.
+ */
+RunSolverCode sudoku_enumerate(IncSolver* solver, const Sudoku* puzzle,
+                               const VarMap* map, const int* assumptions,
+                               int n_assumptions, long limit,
+                               long* n_solutions, SolutionReport report,
+                               void* data, const Deadline* deadline);
+
+/**
+ *
+ */
+const char* uniqueness_name(Uniqueness uniqueness);
+
+#endif